@@ -7,6 +7,7 @@
 #include <unordered_map>
 #include <random>
 #include <time.h>
+#include <glm/gtc/constants.hpp>
 #include "VulkanHelperFunctions.h"
 #include "Vertex.h"
 #define TINYOBJLOADER_IMPLEMENTATION
@@ -32,415 +33,201 @@ BaseObject::BaseObject(ObjectType objectType, const char *objectFile)
 
 }
 
-void BaseObject::CreateObject(VkDevice& device, VkPhysicalDevice& physicalDevice, VkCommandPool& commandPool, VkQueue queue, const uint32_t& swapChainImageSize, const VkRenderPass& renderPass, const VkExtent2D& swapChainExtent) {
-    m_swapChainExtent = swapChainExtent;
-    // create descriptor set layout for uniform buffer (before graphics pipeline)
-    CreateDescriptorSetLayout(device);
-    // create graphics pipeline
-    CreateGraphicsPipeline(device, renderPass, swapChainExtent);
-    // create vertex buffer(must before creating command buffers)
-    CreateVertexBuffer(device, physicalDevice, commandPool, queue);
-    CreateIndexBuffer(device, physicalDevice, commandPool, queue);
-    CreateUniformBuffers(device, physicalDevice, swapChainImageSize);
-    CreateDescriptorPool(device, swapChainImageSize);
-    CreateDescriptorSets(device, swapChainImageSize);
-}
-
-void BaseObject::DestroyObject(VkDevice& device) {
-    // destroy pipeline
-    vkDestroyPipeline(device, m_graphicsPipeline, nullptr);
-    // destroy pipeline layout
-    vkDestroyPipelineLayout(device, m_pipelineLayout, nullptr);
-
-    // destroy the vertex buffer and free memory for the vertex buffer
-    vkDestroyBuffer(device, m_vertexBuffer, nullptr);
-    vkFreeMemory(device, m_vertexBufferMemory, nullptr);
-    // destroy the index buffer
-    vkDestroyBuffer(device, m_indexBuffer, nullptr);
-    vkFreeMemory(device, m_indexBufferMemory, nullptr);
-    // destroy the uniform buffer
-    size_t size = m_uniformBuffers.size();
-    for (size_t i = 0; i < size; i++) {
-        vkDestroyBuffer(device, m_uniformBuffers[i], nullptr);
-        vkFreeMemory(device, m_uniformBuffersMemory[i], nullptr);
+void BaseObject::CreateObject(VkDevice& device, DeviceMemoryAllocator& allocator, StagingArena& stagingArena, UploadContext& uploadContext, GeometryPool& geometryPool, const UniformRing& uniformRing, PipelineRegistry& pipelineRegistry, const VkRenderPass& renderPass, const VkExtent2D& viewExtent) {
+    m_viewExtent = viewExtent;
+    // the graphics pipeline and its layout are shared with the objects of the same description
+    m_pipelineLayout = pipelineRegistry.GetPipelineLayout();
+    m_graphicsPipeline = pipelineRegistry.Acquire(GetPipelineDescription(renderPass));
+    // the vertices and indices live in the shared buffers of the geometry pool (must before recording command buffers)
+    if (!geometryPool.Allocate(GetVertexCount(), GetIndexCount(), m_geometry)) {
+        throw std::runtime_error("Failed to allocate the geometry of the object!");
     }
-
-    // destroy descriptor pool
-    vkDestroyDescriptorPool(device, m_descriptorPool, nullptr);
-    vkDestroyDescriptorSetLayout(device, m_descriptorSetLayout, nullptr);
+    UploadGeometry(device, allocator, stagingArena, uploadContext, geometryPool);
+    CreateDescriptorPool(device);
+    CreateDescriptorSet(device, pipelineRegistry.GetDescriptorSetLayout(), uniformRing);
 }
 
-void BaseObject::CreateDescriptorSetLayout(VkDevice& device) {
-    // uniform buffer object binding (for vertex shader)
-    VkDescriptorSetLayoutBinding uboLayoutBinding{};
-    uboLayoutBinding.binding = 0;
-    uboLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-    uboLayoutBinding.descriptorCount = 1;
-    uboLayoutBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
-    uboLayoutBinding.pImmutableSamplers = nullptr; // Optional
-
-    // texture sampler binding (for fragment shader)
-    VkDescriptorSetLayoutBinding samplerLayoutBinding{};
-    samplerLayoutBinding.binding = 1;
-    samplerLayoutBinding.descriptorCount = 1;
-    samplerLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-    samplerLayoutBinding.pImmutableSamplers = nullptr;
-    samplerLayoutBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
-
-    // array of two bindings
-    std::array<VkDescriptorSetLayoutBinding, 2> bindings = {uboLayoutBinding, samplerLayoutBinding};
-
-    // create descriptor set layout
-    VkDescriptorSetLayoutCreateInfo layoutInfo{};
-    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
-    layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
-    layoutInfo.pBindings = bindings.data();
-
-    if (vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, &m_descriptorSetLayout) != VK_SUCCESS) {
-        throw std::runtime_error("Failed to create descriptor set layout!");
-    }
+void BaseObject::DestroyObject(VkDevice& device, GeometryPool& geometryPool, PipelineRegistry& pipelineRegistry) {
+    // the pipeline is destroyed with its last object, the layout belongs to the registry
+    pipelineRegistry.Release(device, m_graphicsPipeline);
+    m_graphicsPipeline = nullptr;
+    m_pipelineLayout = VK_NULL_HANDLE;
+
+    // give the vertex and index ranges back to the geometry pool
+    geometryPool.Free(m_geometry);
+    // the descriptor set is freed with the descriptor pool
+    vkDestroyDescriptorPool(device, m_descriptorPool, HostAllocator::GetCallbacks());
 }
 
-void BaseObject::CreateDescriptorPool(VkDevice &device, const uint32_t& swapChainImageSize) {
+void BaseObject::CreateDescriptorPool(VkDevice &device) {
     std::array<VkDescriptorPoolSize, 2> poolSizes{};
     // pool size for uniform buffer
-    poolSizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-    poolSizes[0].descriptorCount = swapChainImageSize;
+    poolSizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+    poolSizes[0].descriptorCount = 1;
     // pool size for image sampler
     poolSizes[1].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-    poolSizes[1].descriptorCount = swapChainImageSize;
+    poolSizes[1].descriptorCount = 1;
 
     // create descriptor pool
     VkDescriptorPoolCreateInfo poolInfo{};
     poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
     poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
     poolInfo.pPoolSizes = poolSizes.data();
-    poolInfo.maxSets = swapChainImageSize;
+    // a single set, the uniform ring offset selects the frame
+    poolInfo.maxSets = 1;
 
-    if (vkCreateDescriptorPool(device, &poolInfo, nullptr, &m_descriptorPool) != VK_SUCCESS) {
+    if (vkCreateDescriptorPool(device, &poolInfo, HostAllocator::GetCallbacks(), &m_descriptorPool) != VK_SUCCESS) {
         throw std::runtime_error("Failed to create descriptor pool!");
     }
 }
 
-void BaseObject::CreateDescriptorSets(VkDevice &device, const uint32_t& swapChainImageSize) {
-    std::vector<VkDescriptorSetLayout> layouts(swapChainImageSize, m_descriptorSetLayout);
+void BaseObject::CreateDescriptorSet(VkDevice &device, VkDescriptorSetLayout descriptorSetLayout, const UniformRing& uniformRing) {
     // using descriptor pool and descriptor set layout to create descriptor set
     VkDescriptorSetAllocateInfo allocInfo{};
     allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
     allocInfo.descriptorPool = m_descriptorPool;
-    allocInfo.descriptorSetCount = swapChainImageSize;
-    allocInfo.pSetLayouts = layouts.data();
+    allocInfo.descriptorSetCount = 1;
+    allocInfo.pSetLayouts = &descriptorSetLayout;
 
-    m_descriptorSets.resize(swapChainImageSize);
-    if (vkAllocateDescriptorSets(device, &allocInfo, m_descriptorSets.data()) != VK_SUCCESS) {
+    if (vkAllocateDescriptorSets(device, &allocInfo, &m_descriptorSet) != VK_SUCCESS) {
         throw std::runtime_error("Failed to allocate descriptor sets!");
     }
 
-    for (size_t i = 0; i < swapChainImageSize; i++) {
-        VkDescriptorBufferInfo bufferInfo{};
-        bufferInfo.buffer = m_uniformBuffers[i];
-        bufferInfo.offset = 0;
-        bufferInfo.range = sizeof(UniformBufferObject);
-
-        VkDescriptorImageInfo imageInfo{};
-        imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    VkDescriptorImageInfo imageInfo{};
+    imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
 
-        if (m_texture)
+    if (m_texture)
+    {
+        if (m_texture->GetTextureImageView() && m_texture->GetTextureSampler())
         {
-            if (m_texture->GetTextureImageView() && m_texture->GetTextureSampler())
-            {
-                imageInfo.imageView = *(m_texture->GetTextureImageView());
-                imageInfo.sampler = *(m_texture->GetTextureSampler());
+            imageInfo.imageView = *(m_texture->GetTextureImageView());
+            imageInfo.sampler = *(m_texture->GetTextureSampler());
 
-            }
-        }else {
-            imageInfo.imageView = VK_NULL_HANDLE;
-            imageInfo.sampler = VK_NULL_HANDLE;
         }
-
-        std::array<VkWriteDescriptorSet, 2> descriptorWrites{};
-
-        descriptorWrites[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-        descriptorWrites[0].dstSet = m_descriptorSets[i];
-        descriptorWrites[0].dstBinding = 0;
-        descriptorWrites[0].dstArrayElement = 0;
-        descriptorWrites[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-        descriptorWrites[0].descriptorCount = 1;
-        descriptorWrites[0].pBufferInfo = &bufferInfo;
-
-        descriptorWrites[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-        descriptorWrites[1].dstSet = m_descriptorSets[i];
-        descriptorWrites[1].dstBinding = 1;
-        descriptorWrites[1].dstArrayElement = 0;
-        descriptorWrites[1].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-        descriptorWrites[1].descriptorCount = 1;
-        descriptorWrites[1].pImageInfo = &imageInfo;
-
-        vkUpdateDescriptorSets(device, static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
+    }else {
+        imageInfo.imageView = VK_NULL_HANDLE;
+        imageInfo.sampler = VK_NULL_HANDLE;
     }
 
+    VkWriteDescriptorSet descriptorWrite{};
+    descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    descriptorWrite.dstSet = m_descriptorSet;
+    descriptorWrite.dstBinding = 1;
+    descriptorWrite.dstArrayElement = 0;
+    descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    descriptorWrite.descriptorCount = 1;
+    descriptorWrite.pImageInfo = &imageInfo;
+    vkUpdateDescriptorSets(device, 1, &descriptorWrite, 0, nullptr);
+
+    UpdateUniformDescriptor(device, uniformRing);
 }
 
-void BaseObject::CreateGraphicsPipeline(VkDevice& device, const VkRenderPass& renderPass, const VkExtent2D& swapChainExtent) {
-    std::vector<char> vertShaderCode = VulkanHelperFunctions::ReadBinaryFile("shaders/vert.spv");
-    std::vector<char> fragShaderCode;
+VkDescriptorPool BaseObject::RecreateDescriptorSet(VkDevice &device, VkDescriptorSetLayout descriptorSetLayout, const UniformRing &uniformRing) {
+    // a set bound by submitted command buffers must not be updated, so the object gets a new pool and set
+    VkDescriptorPool oldDescriptorPool = m_descriptorPool;
+    CreateDescriptorPool(device);
+    CreateDescriptorSet(device, descriptorSetLayout, uniformRing);
+    return oldDescriptorPool;
+}
+
+void BaseObject::UpdateUniformDescriptor(VkDevice &device, const UniformRing &uniformRing) {
+    // offset 0 of the ring, the dynamic offset of the frame is added when binding
+    VkDescriptorBufferInfo bufferInfo{};
+    bufferInfo.buffer = uniformRing.GetBuffer();
+    bufferInfo.offset = 0;
+    bufferInfo.range = sizeof(UniformBufferObject);
+
+    VkWriteDescriptorSet descriptorWrite{};
+    descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    descriptorWrite.dstSet = m_descriptorSet;
+    descriptorWrite.dstBinding = 0;
+    descriptorWrite.dstArrayElement = 0;
+    descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+    descriptorWrite.descriptorCount = 1;
+    descriptorWrite.pBufferInfo = &bufferInfo;
+    vkUpdateDescriptorSets(device, 1, &descriptorWrite, 0, nullptr);
+}
+
+GraphicsPipelineDescription BaseObject::GetPipelineDescription(const VkRenderPass& renderPass) const {
+    GraphicsPipelineDescription description;
+    description.vertexShader = "shaders/vert.spv";
     if (m_objectType != ObjectType::FixedTriangle)
     {
-        fragShaderCode = VulkanHelperFunctions::ReadBinaryFile("shaders/fragTexture.spv");
+        description.fragmentShader = "shaders/fragTexture.spv";
     }
     else
     {
-        fragShaderCode = VulkanHelperFunctions::ReadBinaryFile("shaders/fragNoTexture.spv");
+        description.fragmentShader = "shaders/fragNoTexture.spv";
     }
-    // shader module
-    VkShaderModule vertShaderModule = CreateShaderModule(device, vertShaderCode);
-    VkShaderModule fragShaderModule = CreateShaderModule(device, fragShaderCode);
-
-    /* shader stage creation*/
-    // vertex shader stage
-    VkPipelineShaderStageCreateInfo vertShaderStageInfo = {};
-    vertShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-    vertShaderStageInfo.stage = VK_SHADER_STAGE_VERTEX_BIT;
-    vertShaderStageInfo.module = vertShaderModule;
-    vertShaderStageInfo.pName = "main";
-    // frag shader stage
-    VkPipelineShaderStageCreateInfo fragShaderStageInfo = {};
-    fragShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-    fragShaderStageInfo.stage = VK_SHADER_STAGE_FRAGMENT_BIT;
-    fragShaderStageInfo.module = fragShaderModule;
-    fragShaderStageInfo.pName = "main";
-    VkPipelineShaderStageCreateInfo shaderStages[] = {vertShaderStageInfo, fragShaderStageInfo};
-
-    // vertex input stage
-    VkPipelineVertexInputStateCreateInfo vertexInputInfo = {};
-    vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-    auto bindingDescription = Vertex::GetBindingDescription();
+    description.vertexBinding = Vertex::GetBindingDescription();
     auto attributeDescriptions = Vertex::GetAttributeDescriptions();
-    vertexInputInfo.vertexBindingDescriptionCount = 1;
-    vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(attributeDescriptions.size());
-    vertexInputInfo.pVertexBindingDescriptions = &bindingDescription;
-    vertexInputInfo.pVertexAttributeDescriptions = attributeDescriptions.data();
-
-    // input assembly stage
-    VkPipelineInputAssemblyStateCreateInfo inputAssembly = {};
-    inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
-    inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
-    inputAssembly.primitiveRestartEnable = VK_FALSE;
-
-    // viewport and scissors stage
-    VkViewport viewport = {};
-    viewport.x = 0.0f;
-    viewport.y = 0.0f;
-    viewport.width = (float) swapChainExtent.width;
-    viewport.height = (float) swapChainExtent.height;
-    viewport.minDepth = 0.0f;
-    viewport.maxDepth = 1.0f;
-    VkRect2D scissor = {};
-    scissor.offset = {0, 0};
-    scissor.extent = swapChainExtent;
-
-    VkPipelineViewportStateCreateInfo viewportState = {};
-    viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
-    viewportState.viewportCount = 1;
-    viewportState.pViewports = &viewport;
-    viewportState.scissorCount = 1;
-    viewportState.pScissors = &scissor;
-
-    // rasterizer stage
-    VkPipelineRasterizationStateCreateInfo rasterizer = {};
-    rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
-    rasterizer.depthClampEnable = VK_FALSE;
-    rasterizer.rasterizerDiscardEnable = VK_FALSE;
-    rasterizer.polygonMode = VK_POLYGON_MODE_FILL;
-    rasterizer.lineWidth = 1.0f;
-    rasterizer.cullMode = VK_CULL_MODE_BACK_BIT;
-    rasterizer.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE; // counter if using projection matrix
-    rasterizer.depthBiasEnable = VK_FALSE;
-    rasterizer.depthBiasConstantFactor = 0.0f;
-    rasterizer.depthBiasClamp = 0.0f;
-    rasterizer.depthBiasSlopeFactor = 0.0f;
-
-    // multisampling stage
-    VkPipelineMultisampleStateCreateInfo multisampling = {};
-    multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
-    multisampling.sampleShadingEnable = VK_FALSE;
-    multisampling.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
-    multisampling.minSampleShading = 1.0f; // Optional
-    multisampling.pSampleMask = nullptr; // Optional
-    multisampling.alphaToCoverageEnable = VK_FALSE; // Optional
-    multisampling.alphaToOneEnable = VK_FALSE; // Optional
-
-    // TODO depth and stencil testing
-
-    // color blending stage
-    VkPipelineColorBlendAttachmentState colorBlendAttachment = {};
-    colorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
-    colorBlendAttachment.blendEnable = VK_TRUE;
-    colorBlendAttachment.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
-    colorBlendAttachment.dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
-    colorBlendAttachment.colorBlendOp = VK_BLEND_OP_ADD;
-    colorBlendAttachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
-    colorBlendAttachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
-    colorBlendAttachment.alphaBlendOp = VK_BLEND_OP_ADD;
-
-    VkPipelineColorBlendStateCreateInfo colorBlending = {};
-    colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
-    colorBlending.logicOpEnable = VK_FALSE;
-    colorBlending.logicOp = VK_LOGIC_OP_COPY; // Optional
-    colorBlending.attachmentCount = 1;
-    colorBlending.pAttachments = &colorBlendAttachment;
-    colorBlending.blendConstants[0] = 0.0f; // Optional
-    colorBlending.blendConstants[1] = 0.0f; // Optional
-    colorBlending.blendConstants[2] = 0.0f; // Optional
-    colorBlending.blendConstants[3] = 0.0f; // Optional
-
-    // TODO dynamic state
-
-    /*pipeline layout*/
-    // specify the uniform values by creating VkPipelineLayout object
-    VkPipelineLayoutCreateInfo pipelineLayoutInfo = {};
-    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-    // bind with descriptor set layout for uniform buffer
-    pipelineLayoutInfo.setLayoutCount = 1;
-    pipelineLayoutInfo.pSetLayouts = &m_descriptorSetLayout;
-    pipelineLayoutInfo.pushConstantRangeCount = 0; // Optional
-    pipelineLayoutInfo.pPushConstantRanges = nullptr; // Optional
-    if (vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &m_pipelineLayout) != VK_SUCCESS) {
-        throw std::runtime_error("Failed to create pipeline layout!");
-    }
-
-    // create graphics pipeline
-    VkGraphicsPipelineCreateInfo pipelineInfo = {};
-    pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
-    pipelineInfo.stageCount = 2;
-    pipelineInfo.pStages = shaderStages;
-    pipelineInfo.pVertexInputState = &vertexInputInfo;
-    pipelineInfo.pInputAssemblyState = &inputAssembly;
-    pipelineInfo.pViewportState = &viewportState;
-    pipelineInfo.pRasterizationState = &rasterizer;
-    pipelineInfo.pMultisampleState = &multisampling;
-    pipelineInfo.pDepthStencilState = nullptr; // Optional
-    pipelineInfo.pColorBlendState = &colorBlending;
-    pipelineInfo.pDynamicState = nullptr; // Optional
-    pipelineInfo.layout = m_pipelineLayout;
-    pipelineInfo.renderPass = renderPass;
-    pipelineInfo.subpass = 0;
-    pipelineInfo.basePipelineHandle = VK_NULL_HANDLE; // Optional
-    pipelineInfo.basePipelineIndex = -1; // Optional
-    if (vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &m_graphicsPipeline) != VK_SUCCESS) {
-        throw std::runtime_error("failed to create graphics pipeline!");
-    }
-
-    // destroy shader module
-    vkDestroyShaderModule(device, fragShaderModule, nullptr);
-    vkDestroyShaderModule(device, vertShaderModule, nullptr);
-
+    description.vertexAttributes.assign(attributeDescriptions.begin(), attributeDescriptions.end());
+    description.renderPass = renderPass;
+    return description;
 }
 
-VkShaderModule BaseObject::CreateShaderModule(VkDevice& device, const std::vector<char> &shaderCode) {
-    VkShaderModuleCreateInfo createInfo = {};
-    createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-    createInfo.codeSize = shaderCode.size();
-    createInfo.pCode = reinterpret_cast<const uint32_t*>(shaderCode.data());
-    VkShaderModule shaderModule;
-    if (vkCreateShaderModule(device, &createInfo, nullptr, &shaderModule) != VK_SUCCESS) {
-        throw std::runtime_error("Failed to create shader module!");
-    }
-    return shaderModule;
+void BaseObject::UploadGeometry(VkDevice& device, DeviceMemoryAllocator& allocator, StagingArena& stagingArena, UploadContext& uploadContext, GeometryPool& geometryPool) {
+    // copy vertices and indices to the staging arena and record copying them to the ranges of the object into the upload batch
+    geometryPool.Upload(device, allocator, stagingArena, uploadContext, m_geometry, m_vertices, m_indices);
 }
 
-void BaseObject::CreateVertexBuffer(VkDevice& device, VkPhysicalDevice& physicalDevice, VkCommandPool& commandPool, VkQueue queue) {
-    // Buffer size (size of input vertices data)
-    VkDeviceSize bufferSize = sizeof(m_vertices[0]) * m_vertices.size();
-
-    // create staging buffer
-    VkBuffer stagingBuffer;
-    VkDeviceMemory stagingBufferMemory;
-    // create buffer (specify the buffer size, buffer usage, memory property flag, creating buffer and creating buffer memory)
-    VulkanHelperFunctions::CreateBuffer(device, physicalDevice, bufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingBufferMemory);
-
-    // copy vertices data to staging buffer
-    void* data;
-    vkMapMemory(device, stagingBufferMemory, 0, bufferSize, 0, &data);
-    memcpy(data, m_vertices.data(), (size_t) bufferSize);
-    vkUnmapMemory(device, stagingBufferMemory);
-
-    // create vertex buffer
-    VulkanHelperFunctions::CreateBuffer(device, physicalDevice, bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_vertexBuffer, m_vertexBufferMemory);
-
-    // copy data from staging buffer to vertex buffer
-    VulkanHelperFunctions::CopyBuffer(device, commandPool, queue, stagingBuffer, m_vertexBuffer, bufferSize);
-
-    // destroy staging buffer
-    vkDestroyBuffer(device, stagingBuffer, nullptr);
-    vkFreeMemory(device, stagingBufferMemory, nullptr);
-}
-
-void BaseObject::CreateIndexBuffer(VkDevice& device, VkPhysicalDevice& physicalDevice, VkCommandPool& commandPool, VkQueue queue) {
-    VkDeviceSize bufferSize = sizeof(m_indices[0]) * m_indices.size();
-
-    VkBuffer stagingBuffer;
-    VkDeviceMemory stagingBufferMemory;
-    VulkanHelperFunctions::CreateBuffer(device, physicalDevice, bufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingBufferMemory);
-
-    void* data;
-    vkMapMemory(device, stagingBufferMemory, 0, bufferSize, 0, &data);
-    memcpy(data, m_indices.data(), (size_t) bufferSize);
-    vkUnmapMemory(device, stagingBufferMemory);
-
-    // create index buffer and allocate the index memory
-    VulkanHelperFunctions::CreateBuffer(device, physicalDevice, bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_indexBuffer, m_indexBufferMemory);
-
-    VulkanHelperFunctions::CopyBuffer(device, commandPool, queue, stagingBuffer, m_indexBuffer, bufferSize);
-
-    vkDestroyBuffer(device, stagingBuffer, nullptr);
-    vkFreeMemory(device, stagingBufferMemory, nullptr);
-}
-
-void BaseObject::CreateUniformBuffers(VkDevice& device, VkPhysicalDevice& physicalDevice, const uint32_t& swapChainImageSize) {
-    VkDeviceSize bufferSize = sizeof(UniformBufferObject);
-    // create uniform buffer for each image in the swap chain
-    m_uniformBuffers.resize(swapChainImageSize);
-    m_uniformBuffersMemory.resize(swapChainImageSize);
-
-    for (size_t i = 0; i < swapChainImageSize; i++) {
-        VulkanHelperFunctions::CreateBuffer(device, physicalDevice, bufferSize, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, m_uniformBuffers[i], m_uniformBuffersMemory[i]);
+void BaseObject::Update(float deltaTime) {
+    m_previousState = m_currentState;
+    switch (m_objectType) {
+        case ObjectType::FixedTriangle :
+            m_triangle.UpdateTrianglePosition(m_triMoveSpeed * deltaTime, m_triMoveDirection);
+            UpdateTriMovingDirection();
+            m_currentState.position = m_triangle.centerPos;
+            break;
+        case ObjectType::FixedRectangle :
+            // 45 degrees/s
+            m_currentState.angle += glm::radians(45.0f) * deltaTime;
+            break;
+        case ObjectType::OBJ_Model :
+            m_currentState.angle += 0.5f * glm::radians(45.0f) * deltaTime;
+            break;
+        case ObjectType::DefaultMax :
+            break;
+    }
+    // keep the angle small for float precision, both states are wrapped so that interpolating between them still works
+    if (m_currentState.angle > glm::two_pi<float>()) {
+        m_currentState.angle -= glm::two_pi<float>();
+        m_previousState.angle -= glm::two_pi<float>();
     }
 }
 
-void BaseObject::UpdateUniformBuffer(VkDevice &device, float duration, uint32_t currentImage) {
+void BaseObject::UpdateUniformBuffer(UniformRing &uniformRing, float alpha) {
     UniformBufferObject ubo;
-    // TODO OnCollision() callback, Update(float deltaTime), Begin(), like game engine
+    // render between the last two simulation steps, so that the motion is smooth at any frame rate
+    ObjectState state;
+    state.position = glm::mix(m_previousState.position, m_currentState.position, alpha);
+    state.angle = glm::mix(m_previousState.angle, m_currentState.angle, alpha);
     switch (m_objectType) {
         case ObjectType::FixedTriangle :
             ubo.projectionMatrix = glm::mat4(1.0);
             ubo.projectionMatrix[1][1] *= -1;
-            ubo.transformMatrix = ubo.projectionMatrix * TranslateObject(m_triMoveSpeed);
-            UpdateTriMovingDirection();
+            ubo.transformMatrix = ubo.projectionMatrix * TranslateObject(state.position);
             break;
         case ObjectType::FixedRectangle :
             ubo.projectionMatrix = glm::mat4(1.0);
             ubo.projectionMatrix[1][1] *= -1;
-            ubo.modelMatrix = RotateObject(duration);
+            ubo.modelMatrix = RotateObject(state.angle);
             ubo.transformMatrix = ubo.projectionMatrix * ubo.modelMatrix;
             break;
         case ObjectType::OBJ_Model :
             // view matrix
             ubo.viewMatrix = glm::lookAt(glm::vec3(2.0f, 2.0f, 2.0f), glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f));
             // projection matrix
-            ubo.projectionMatrix = glm::perspective(glm::radians(45.0f), m_swapChainExtent.width / (float) m_swapChainExtent.height, 0.1f, 10.0f);
+            ubo.projectionMatrix = glm::perspective(glm::radians(45.0f), m_viewExtent.width / (float) m_viewExtent.height, 0.1f, 10.0f);
             ubo.projectionMatrix[1][1] *= -1;
-            ubo.modelMatrix = RotateObject(0.5f * duration);
+            ubo.modelMatrix = RotateObject(state.angle);
             ubo.transformMatrix =  ubo.projectionMatrix * ubo.viewMatrix;
             break;
         case ObjectType::DefaultMax :
             break;
     }
-    // copy ubo data to uniform buffer
-    void* data;
-    vkMapMemory(device, m_uniformBuffersMemory[currentImage], 0, sizeof(ubo), 0, &data);
-    memcpy(data, &ubo, sizeof(ubo));
-    vkUnmapMemory(device, m_uniformBuffersMemory[currentImage]);
+    // copy ubo data to the frame's region of the uniform ring, and bind it at that offset
+    m_uniformOffset = uniformRing.Push(&ubo, sizeof(ubo));
 }
 
 void BaseObject::CreateTriangle() {
@@ -460,12 +247,8 @@ void BaseObject::CreateTriangle() {
     generator.seed(time(NULL));
     std::normal_distribution<float> distribution(-1.f,1.f);
     m_triMoveDirection = glm::normalize(glm::vec3(distribution(generator), distribution(generator), 0.0f));
-    // distance/frame, but it's not stable.
-    m_triMoveSpeed = std::abs(distribution(generator) / 50.f);
-
-
-    // TODO stable way: speed(distance/seconds) * deltaTime(seconds/frame) = distance/frame
-    // TODO measure the deltaTime
+    // distance/second (the former distance/frame at 60 frames/s), scaled by the fixed time step of the simulation
+    m_triMoveSpeed = std::abs(distribution(generator) / 50.f) * 60.f;
 }
 
 void BaseObject::CreateRectangle() {
@@ -519,14 +302,13 @@ void BaseObject::CreateOBJ(const char *objectFile) {
 
 }
 
-glm::mat4 BaseObject::TranslateObject(float rate) {
-    m_triangle.UpdateTrianglePosition(rate,m_triMoveDirection);
-    return glm::translate(glm::mat4(1.0f), m_triangle.centerPos);
+glm::mat4 BaseObject::TranslateObject(const glm::vec3& position) {
+    return glm::translate(glm::mat4(1.0f), position);
 }
 
-glm::mat4 BaseObject::RotateObject(float rate) {
+glm::mat4 BaseObject::RotateObject(float angle) {
     // model matrix
-    return glm::rotate(glm::mat4(1.0f), rate * glm::radians(45.0f), glm::vec3(0.0f, 0.0f, 1.0f));
+    return glm::rotate(glm::mat4(1.0f), angle, glm::vec3(0.0f, 0.0f, 1.0f));
 }
 
 std::map<WindowEdge, const glm::vec3> WindowEdgeNormal{
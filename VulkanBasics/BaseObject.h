@@ -5,9 +5,15 @@
 #ifndef VULKANBASICS_BASEOBJECT_H
 #define VULKANBASICS_BASEOBJECT_H
 #include <vector>
+#include <string>
 #include "Vertex.h"
 #include <optional>
 #include "BaseTexture.h"
+#include "UniformRing.h"
+#include "StagingArena.h"
+#include "UploadContext.h"
+#include "GeometryPool.h"
+#include "PipelineRegistry.h"
 
 
 enum class ObjectType{FixedTriangle, FixedRectangle, OBJ_Model, DefaultMax};
@@ -60,18 +66,44 @@ struct Triangle{
     }
 };
 
+// simulated state of an object, rendered interpolated between two simulation steps
+struct ObjectState {
+    // translation (the moving triangle)
+    glm::vec3 position = glm::vec3(0.f);
+    // rotation around the z axis (radians)
+    float angle = 0.f;
+};
+
 class BaseObject {
 public:
     BaseObject(ObjectType objectType, const char* objectFile);
 
-    void CreateObject(VkDevice& device, VkPhysicalDevice& physicalDevice, VkCommandPool& commandPool, VkQueue queue, const uint32_t& swapChainImageSize, const VkRenderPass& renderPass, const VkExtent2D& swapChainExtent);
-    void DestroyObject(VkDevice& device);
+    // the geometry pool must have room for the mesh (GetVertexCount/GetIndexCount)
+    void CreateObject(VkDevice& device, DeviceMemoryAllocator& allocator, StagingArena& stagingArena, UploadContext& uploadContext, GeometryPool& geometryPool, const UniformRing& uniformRing, PipelineRegistry& pipelineRegistry, const VkRenderPass& renderPass, const VkExtent2D& viewExtent);
+    void DestroyObject(VkDevice& device, GeometryPool& geometryPool, PipelineRegistry& pipelineRegistry);
 
-    // update uniform buffer
-    void UpdateUniformBuffer(VkDevice &device, float duration, uint32_t currentImage);
+    inline uint32_t GetVertexCount() const {return static_cast<uint32_t>(m_vertices.size());}
+    inline uint32_t GetIndexCount() const {return static_cast<uint32_t>(m_indices.size());}
+    // upload the mesh to its ranges of the geometry pool
+    void UploadGeometry(VkDevice& device, DeviceMemoryAllocator& allocator, StagingArena& stagingArena, UploadContext& uploadContext, GeometryPool& geometryPool);
+
+    // advance the simulation by a fixed time step (seconds)
+    void Update(float deltaTime);
+    // push the uniform data of the state interpolated between the last two simulation steps (alpha in [0, 1])
+    // into the current frame of the uniform ring
+    void UpdateUniformBuffer(UniformRing& uniformRing, float alpha);
 
     inline void SetTexture(BaseTexture* texture){m_texture = texture;}
 
+    inline void SetName(const std::string& name){m_name = name;}
+    inline const std::string& GetName() const {return m_name;}
+
+    // the extent of the views has changed, e.g. the swap chain has been recreated (used by the projection matrix)
+    inline void SetViewExtent(const VkExtent2D& viewExtent){m_viewExtent = viewExtent;}
+    // a new descriptor set pointing at the buffer of the uniform ring after it has been recreated, the frames in flight
+    // may still bind the old set: returns its pool, to be destroyed once they have finished
+    VkDescriptorPool RecreateDescriptorSet(VkDevice& device, VkDescriptorSetLayout descriptorSetLayout, const UniformRing& uniformRing);
+
 private:
     // create triangle (task1)
     void CreateTriangle();
@@ -80,71 +112,52 @@ private:
     // create OBJ object
     void CreateOBJ(const char* objectFile);
 
-    // create shader module
-    VkShaderModule CreateShaderModule(VkDevice& device, const std::vector<char>& shaderCode);
-
-    // create graphics pipeline layout and pipeline
-    void CreateGraphicsPipeline(VkDevice& device, const VkRenderPass& renderPass, const VkExtent2D& swapChainExtent);
-
-    // create descriptor set layout for uniform buffer (before graphics pipeline)
-    void CreateDescriptorSetLayout(VkDevice& device);
+    // shaders and fixed function state of the graphics pipeline (viewport and scissor are dynamic, so the pipeline doesn't depend on the extent)
+    GraphicsPipelineDescription GetPipelineDescription(const VkRenderPass& renderPass) const;
 
     // create descriptor pool
-    void CreateDescriptorPool(VkDevice& device, const uint32_t& swapChainImageSize);
-
-    // create descriptor sets
-    void CreateDescriptorSets(VkDevice& device, const uint32_t& swapChainImageSize);
+    void CreateDescriptorPool(VkDevice& device);
 
-    // create vertex buffer
-    void CreateVertexBuffer(VkDevice& device, VkPhysicalDevice& physicalDevice, VkCommandPool& commandPool, VkQueue queue);
+    // create descriptor set (the same for all the frames)
+    void CreateDescriptorSet(VkDevice& device, VkDescriptorSetLayout descriptorSetLayout, const UniformRing& uniformRing);
+    // point the descriptor set at the buffer of the uniform ring
+    void UpdateUniformDescriptor(VkDevice& device, const UniformRing& uniformRing);
 
-    // create index buffer
-    void CreateIndexBuffer(VkDevice& device, VkPhysicalDevice& physicalDevice, VkCommandPool& commandPool, VkQueue queue);
-
-    // create uniform buffers
-    void CreateUniformBuffers(VkDevice& device, VkPhysicalDevice& physicalDevice, const uint32_t& swapChainImageSize);
 
     /*transform the object*/
     // translate the object
-    glm::mat4 TranslateObject(float rate);
-    // rotate the object
-    glm::mat4 RotateObject(float rate);
+    glm::mat4 TranslateObject(const glm::vec3& position);
+    // rotate the object (radians)
+    glm::mat4 RotateObject(float angle);
 
     // update triangle moving direction if collided with window
     void UpdateTriMovingDirection();
 
 public:
-    // pipeline layout
-    VkPipelineLayout m_pipelineLayout;
-    // graphics Pipeline;
-    VkPipeline m_graphicsPipeline;
-    std::vector<VkDescriptorSet> m_descriptorSets;
-    // index buffer
-    VkBuffer m_indexBuffer;
-    // vertex buffer
-    VkBuffer m_vertexBuffer;
-    // indices
-    std::vector<uint32_t> m_indices;
+    // pipeline layout and graphics pipeline, owned by the pipeline registry (the pipeline is compiled before the next frame)
+    VkPipelineLayout m_pipelineLayout = VK_NULL_HANDLE;
+    const SharedPipeline* m_graphicsPipeline = nullptr;
+    VkDescriptorSet m_descriptorSet;
+    // offset of the uniform data of the current frame in the uniform ring
+    uint32_t m_uniformOffset = 0;
+    // vertices and indices of the mesh in the geometry pool
+    GeometryRange m_geometry;
 
 private:
     ObjectType m_objectType;
 
-    VkExtent2D m_swapChainExtent;
-
-    VkDescriptorSetLayout m_descriptorSetLayout;
-    VkDescriptorPool m_descriptorPool;
-
-    // memory for vertex buffer
-    VkDeviceMemory m_vertexBufferMemory;
+    // name given when adding the object to the application
+    std::string m_name;
 
-    VkDeviceMemory m_indexBufferMemory;
+    // extent of the views the object is drawn to
+    VkExtent2D m_viewExtent;
 
-    // uniform buffers and memories for them
-    std::vector<VkBuffer> m_uniformBuffers;
-    std::vector<VkDeviceMemory> m_uniformBuffersMemory;
+    VkDescriptorPool m_descriptorPool;
 
     // vertices
     std::vector<Vertex> m_vertices;
+    // indices (relative to the first vertex of the mesh)
+    std::vector<uint32_t> m_indices;
 
     BaseTexture* m_texture = nullptr;
 
@@ -154,6 +167,10 @@ private:
     glm::vec3 m_triMoveDirection;
     // triangle initial moving speed (e.g. 0.5 unit/s using normalized device coordinates)
     glm::float32 m_triMoveSpeed;
+
+    // state after the last two simulation steps
+    ObjectState m_previousState;
+    ObjectState m_currentState;
 };
 
 
@@ -11,24 +11,23 @@ BaseTexture::BaseTexture(const char *textureFile) {
     m_textureFile = textureFile;
 }
 
-void BaseTexture::CreateTexture(VkDevice &device, VkPhysicalDevice &physicalDevice, VkCommandPool &commandPool,
-                                VkQueue &queue) {
-    // create texture image (after creating command pool) and its image view
-    CreateTextureImage(device, physicalDevice, commandPool, queue);
+void BaseTexture::CreateTexture(VkDevice &device, VkPhysicalDevice &physicalDevice, DeviceMemoryAllocator &allocator,
+                                StagingArena &stagingArena, UploadContext &uploadContext) {
+    // create texture image (recorded into the upload batch) and its image view
+    CreateTextureImage(device, allocator, stagingArena, uploadContext);
     CreateTextureImageView(device);
     CreateTextureSampler(device, physicalDevice);
 }
 
-void BaseTexture::DestroyTexture(VkDevice &device) {
+void BaseTexture::DestroyTexture(VkDevice &device, DeviceMemoryAllocator &allocator) {
         // destroy the texture image, texture image view and texture memory, texture sampler
-        vkDestroySampler(device, m_textureSampler, nullptr);
-        vkDestroyImageView(device, m_textureImageView, nullptr);
-        vkDestroyImage(device, m_textureImage, nullptr);
-        vkFreeMemory(device, m_textureImageMemory, nullptr);
+        vkDestroySampler(device, m_textureSampler, HostAllocator::GetCallbacks());
+        vkDestroyImageView(device, m_textureImageView, HostAllocator::GetCallbacks());
+        VulkanHelperFunctions::DestroyImage(device, allocator, m_textureImage, m_textureImageMemory);
 }
 
-void BaseTexture::CreateTextureImage(VkDevice &device, VkPhysicalDevice &physicalDevice, VkCommandPool &commandPool,
-                                     VkQueue &queue) {
+void BaseTexture::CreateTextureImage(VkDevice &device, DeviceMemoryAllocator &allocator, StagingArena &stagingArena,
+                                     UploadContext &uploadContext) {
     // load the image
     int texWidth, texHeight, texChannels;
     stbi_uc* pixels = stbi_load(m_textureFile, &texWidth, &texHeight, &texChannels, STBI_rgb_alpha);
@@ -36,28 +35,17 @@ void BaseTexture::CreateTextureImage(VkDevice &device, VkPhysicalDevice &physica
     if (!pixels) {
         throw std::runtime_error("Failed to load texture image!");
     }
-    // copy pixels data to stage buffer
-    VkBuffer stagingBuffer;
-    VkDeviceMemory stagingBufferMemory;
-    VulkanHelperFunctions::CreateBuffer( device, physicalDevice,imageSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingBufferMemory);
-    void* data;
-    vkMapMemory(device, stagingBufferMemory, 0, imageSize, 0, &data);
-    memcpy(data, pixels, static_cast<size_t>(imageSize));
-    vkUnmapMemory(device, stagingBufferMemory);
+    // copy pixels data to the staging arena
+    StagingAllocation staging = stagingArena.Allocate(device, allocator, imageSize);
+    memcpy(staging.mappedData, pixels, static_cast<size_t>(imageSize));
     // free pixels data
     stbi_image_free(pixels);
 
     // create image object
-    VulkanHelperFunctions::CreateImage(device, physicalDevice, texWidth, texHeight, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_textureImage, m_textureImageMemory);
-    // transit image layout to VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL
-    VulkanHelperFunctions::TransitionImageLayout(device, commandPool, queue, m_textureImage, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
-    // copy staging buffer data to image object
-    VulkanHelperFunctions::CopyBufferToImage(device, stagingBuffer,commandPool, queue, m_textureImage, static_cast<uint32_t>(texWidth), static_cast<uint32_t>(texHeight));
-    // transit image layout optimal for shader access
-    VulkanHelperFunctions::TransitionImageLayout(device, commandPool, queue, m_textureImage, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
-    // destroy the logical device
-    vkDestroyBuffer(device, stagingBuffer, nullptr);
-    vkFreeMemory(device, stagingBufferMemory, nullptr);
+    VulkanHelperFunctions::CreateImage(device, allocator, texWidth, texHeight, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, MemoryCategory::Texture, m_textureImage, m_textureImageMemory);
+    // record the layout transitions and copying staging buffer data to image object into the upload batch,
+    // the image ends up optimal for shader access
+    uploadContext.CopyBufferToImage(device, staging, m_textureImage, VK_FORMAT_R8G8B8A8_SRGB, static_cast<uint32_t>(texWidth), static_cast<uint32_t>(texHeight));
 }
 
 void BaseTexture::CreateTextureImageView(VkDevice &device) {
@@ -91,7 +79,7 @@ void BaseTexture::CreateTextureSampler(VkDevice &device, VkPhysicalDevice &physi
     samplerInfo.minLod = 0.0f;
     samplerInfo.maxLod = 0.0f;
 
-    if (vkCreateSampler(device, &samplerInfo, nullptr, &m_textureSampler) != VK_SUCCESS) {
+    if (vkCreateSampler(device, &samplerInfo, HostAllocator::GetCallbacks(), &m_textureSampler) != VK_SUCCESS) {
         throw std::runtime_error("Failed to create texture sampler!");
     }
 
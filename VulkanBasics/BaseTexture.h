@@ -5,12 +5,15 @@
 #ifndef VULKANBASICS_BASETEXTURE_H
 #define VULKANBASICS_BASETEXTURE_H
 #include <vulkan/vulkan.h>
+#include "DeviceMemoryAllocator.h"
+#include "StagingArena.h"
+#include "UploadContext.h"
 
 class BaseTexture {
 public:
     BaseTexture(const char* textureFile);
-    void CreateTexture(VkDevice& device, VkPhysicalDevice& physicalDevice, VkCommandPool& commandPool, VkQueue& queue);
-    void DestroyTexture(VkDevice& device);
+    void CreateTexture(VkDevice& device, VkPhysicalDevice& physicalDevice, DeviceMemoryAllocator& allocator, StagingArena& stagingArena, UploadContext& uploadContext);
+    void DestroyTexture(VkDevice& device, DeviceMemoryAllocator& allocator);
 
     const VkImageView* GetTextureImageView() const;
 
@@ -18,7 +21,7 @@ public:
 
 private:
     // create texture image
-    void CreateTextureImage(VkDevice& device, VkPhysicalDevice& physicalDevice, VkCommandPool& commandPool, VkQueue& queue);
+    void CreateTextureImage(VkDevice& device, DeviceMemoryAllocator& allocator, StagingArena& stagingArena, UploadContext& uploadContext);
 
     // create texture image view
     void CreateTextureImageView(VkDevice& device);
@@ -33,7 +36,7 @@ private:
 
     // texture image and its memory and image view
     VkImage m_textureImage;
-    VkDeviceMemory m_textureImageMemory;
+    MemoryAllocation m_textureImageMemory;
 
     VkImageView m_textureImageView;
 
@@ -5,66 +5,266 @@
 #include <cstdint>
 #include <cstring>
 #include <chrono>
+#include <cmath>
+#include <algorithm>
 #include "BasicApplication.h"
 #include "VulkanHelperFunctions.h"
 
-void BasicApplication::InitialApplication(int windowWidth, int windowHeight, const char *windowName) {
+// objects the uniform ring has room for before it grows
+#define INITIAL_UNIFORM_RING_OBJECTS 64
+// size of the staging buffers of the uploads, bigger resources get a chunk of their size
+#define STAGING_CHUNK_SIZE (16ull * 1024 * 1024)
+// vertices and indices the geometry pool has room for before it grows
+#define INITIAL_GEOMETRY_POOL_VERTICES (64u * 1024)
+#define INITIAL_GEOMETRY_POOL_INDICES (256u * 1024)
+// staged bytes after which the uploads of the objects being added are submitted and waited for, to bound the staging memory
+#define MAX_PENDING_UPLOAD_BYTES (64ull * 1024 * 1024)
+
+void BasicApplication::InitialApplication(int windowWidth, int windowHeight, const char *windowName, const ApplicationSettings& settings) {
+    m_startupBeginTime = std::chrono::high_resolution_clock::now();
+    if (settings.framesInFlight == 0) {
+        throw std::runtime_error("At least one frame in flight is required!");
+    }
+    m_framesInFlight = settings.framesInFlight;
+    m_headless = settings.headless;
+    if (m_headless && settings.headlessImageCount == 0) {
+        throw std::runtime_error("At least one headless image is required!");
+    }
+    m_headlessImageCount = settings.headlessImageCount;
+    m_frameProfiler.SetEnabled(settings.enableFrameProfiler);
+    m_frameTimingsFile = settings.frameTimingsFile;
+    m_enableGpuProfiler = settings.enableGpuProfiler;
+    m_presentPolicy = settings.presentPolicy;
+    if (m_presentPolicy >= PresentPolicy::Count) {
+        throw std::runtime_error("Failed to set an unknown present policy!");
+    }
+    if (m_presentPolicy == PresentPolicy::TargetFps && settings.targetFps <= 0.0) {
+        throw std::runtime_error("Target fps must be positive!");
+    }
+    m_framePacer.SetTargetFps(m_presentPolicy == PresentPolicy::TargetFps ? settings.targetFps : 0.0);
+    m_preferTimelineSemaphore = settings.preferTimelineSemaphore;
+    m_preferTransferQueue = settings.preferTransferQueue;
+    m_pipelineCacheFile = settings.pipelineCacheFile;
+    int recordingThreadCount = settings.recordingThreadCount;
+    if (recordingThreadCount < 0) {
+        recordingThreadCount = std::max(static_cast<int>(std::thread::hardware_concurrency()) - 1, 0);
+    }
+    m_recordingThreads.Start(static_cast<uint32_t>(recordingThreadCount));
+    m_minObjectsPerRecordingThread = std::max<uint32_t>(settings.minObjectsPerRecordingThread, 1);
+    if (settings.simulationRate <= 0.0) {
+        throw std::runtime_error("Simulation rate must be positive!");
+    }
+    m_simulationTimeStep = 1.0 / settings.simulationRate;
+    m_maxSimulationStepsPerFrame = std::max<uint32_t>(settings.maxSimulationStepsPerFrame, 1);
+    if (settings.viewCount == 0) {
+        throw std::runtime_error("At least one view is required!");
+    }
+    m_viewCount = settings.viewCount;
+    if (m_headless) {
+        // nothing is presented, so the swap chain extension is not required
+        m_deviceExtensions.clear();
+    }
+    // before the instance, every Vulkan object must be created and destroyed with the same callbacks
+    m_trackHostAllocations = settings.trackHostAllocations;
+    m_printStatistics = settings.printStatistics;
+    if (m_trackHostAllocations) {
+        m_hostAllocator.Create();
+    }
     InitWindow(windowWidth, windowHeight, windowName);
     InitVulkan();
 }
 
 
-void BasicApplication::RunApplication() {
-    // create command buffers
-    CreateCommandBuffers();
-    MainLoop();
+void BasicApplication::RunApplication(uint32_t frameCount) {
+    if (m_headless && frameCount == 0) {
+        throw std::runtime_error("Headless application has no window to close, a frame count is required!");
+    }
+    MainLoop(frameCount);
     CleanUp();
 }
 
+FrameTimingReport BasicApplication::GetFrameTimingReport() const {
+    return m_frameProfiler.GetReport();
+}
+
+void BasicApplication::PrintFrameTimings() const {
+    m_frameProfiler.PrintReport(std::cout);
+}
+
+std::vector<GpuScopeTiming> BasicApplication::GetGpuTimings() const {
+    return m_gpuProfiler.GetTimings();
+}
+
+void BasicApplication::PrintGpuTimings() const {
+    m_gpuProfiler.PrintReport(std::cout);
+}
+
+void BasicApplication::SetPresentPolicy(PresentPolicy policy, double targetFps) {
+    if (policy == PresentPolicy::TargetFps && targetFps <= 0.0) {
+        throw std::runtime_error("Target fps must be positive!");
+    }
+    if (policy >= PresentPolicy::Count) {
+        throw std::runtime_error("Failed to set an unknown present policy!");
+    }
+    // only the swap chain depends on the present mode, policies sharing their present modes only differ in pacing.
+    // A change not applied by a frame yet must not be lost
+    m_presentModeChanged |= !m_headless && GetPreferredPresentModes(policy) != GetPreferredPresentModes(m_presentPolicy);
+    m_presentPolicy = policy;
+    m_framePacer.SetTargetFps(policy == PresentPolicy::TargetFps ? targetFps : 0.0);
+    // intervals of the previous policy would hide the jitter of the new one
+    m_framePacer.Reset();
+    if (m_printStatistics) {
+        std::cout << "Present policy: " << FramePacer::GetPolicyName(policy) << std::endl;
+    }
+}
+
+FramePacingReport BasicApplication::GetFramePacingReport() const {
+    return m_framePacer.GetReport();
+}
+
+void BasicApplication::PrintFramePacing() const {
+    std::cout << "Present policy: " << FramePacer::GetPolicyName(m_presentPolicy) << std::endl;
+    m_framePacer.PrintReport(std::cout);
+}
+
 void BasicApplication::CleanUp() {
-    // destroy the object
-    DestroyObjects();
-    DestroyTextures();
+    // dump the frame timings, the report is printed on request (T key, or the statistics setting)
+    if (m_frameProfiler.IsEnabled()) {
+        if (m_printStatistics) {
+            PrintFrameTimings();
+        }
+        if (m_frameTimingsFile) {
+            // a failed export must not skip destroying the Vulkan objects
+            try {
+                m_frameProfiler.ExportCSV(std::string(m_frameTimingsFile) + ".csv");
+                m_frameProfiler.ExportJSON(std::string(m_frameTimingsFile) + ".json");
+            } catch (const std::exception& e) {
+                std::cerr << "Failed to export the frame timings: " << e.what() << std::endl;
+            }
+        }
+    }
+    if (m_printStatistics) {
+        PrintFramePacing();
+    }
+    // the device is idle, so the frames still in flight at the end can be resolved too
+    if (m_gpuProfiler.IsEnabled()) {
+        for (uint32_t i = 0; i < m_framesInFlight; i++) {
+            m_gpuProfiler.Resolve(m_logicalDevice, i);
+        }
+        PrintGpuTimings();
+    }
 
-    vkDestroySemaphore(m_logicalDevice, m_renderFinishedSemaphore, nullptr);
-    vkDestroySemaphore(m_logicalDevice, m_imageAvailableSemaphore, nullptr);
-    vkDestroyCommandPool(m_logicalDevice, m_commandPool, nullptr);
-    // destroy frame buffers
-    for (auto framebuffer : m_swapChainFrameBuffers) {
-        vkDestroyFramebuffer(m_logicalDevice, framebuffer, nullptr);
+    // allocations by category, fragmentation and heap budgets while the scene is still alive
+    if (m_printStatistics) {
+        m_memoryAllocator.PrintStatistics(std::cout);
     }
 
-    // destroy image views
-    for (VkImageView imageView : m_swapChainImageViews) {
-        vkDestroyImageView(m_logicalDevice, imageView, nullptr);
+    // destroy the object, the device is idle so the removed ones can go too
+    m_deletionQueue.Flush();
+    if (m_printStatistics) {
+        std::cout << "Objects: " << m_deletionQueue.GetDeletedCount() << " removed while running" << std::endl;
     }
+    DestroyObjects();
+    DestroyTextures();
+    if (m_printStatistics) {
+        std::cout << "Geometry pool: " << m_geometryPool.GetUsedVertexCount() << "/" << m_geometryPool.GetVertexCapacity() << " vertices, "
+                  << m_geometryPool.GetUsedIndexCount() << "/" << m_geometryPool.GetIndexCapacity() << " indices in use" << std::endl;
+    }
+    m_geometryPool.Destroy(m_logicalDevice, m_memoryAllocator);
+    m_uniformRing.Destroy(m_logicalDevice, m_memoryAllocator);
+    if (m_printStatistics) {
+        std::cout << "Uploads: " << m_uploadContext.GetSubmitCount() << " batches submitted, "
+                  << m_stagingArena.GetCreatedChunkCount() << " staging buffers created" << std::endl;
+    }
+    m_uploadContext.Destroy(m_logicalDevice);
+    m_stagingArena.Destroy(m_logicalDevice, m_memoryAllocator);
+    // the objects have released their pipelines
+    m_pipelineRegistry.Destroy(m_logicalDevice);
+    m_shaderLibrary.Destroy(m_logicalDevice);
+    // the pipelines created while running are in the cache now, the next run starts warm
+    m_pipelineCache.Destroy(m_logicalDevice);
+
+    for (size_t i = 0; i < m_framesInFlight; i++) {
+        vkDestroySemaphore(m_logicalDevice, m_renderFinishedSemaphores[i], HostAllocator::GetCallbacks());
+        vkDestroySemaphore(m_logicalDevice, m_imageAvailableSemaphores[i], HostAllocator::GetCallbacks());
+    }
+    m_graphicsTimeline.Destroy(m_logicalDevice);
+    m_gpuProfiler.Destroy(m_logicalDevice);
+    DestroyFrameCommandPools();
+    // destroy frame buffers and image views
+    CleanupSwapChain();
+
+    // destroy the swap chain (or the headless images) before the device
+    if (m_headless) {
+        for (size_t i = 0; i < m_swapChainImages.size(); i++) {
+            VulkanHelperFunctions::DestroyImage(m_logicalDevice, m_memoryAllocator, m_swapChainImages[i], m_headlessImagesMemory[i]);
+        }
+    } else {
+        vkDestroySwapchainKHR(m_logicalDevice, m_swapChain, HostAllocator::GetCallbacks());
+    }
+    vkDestroyRenderPass(m_logicalDevice, m_renderPass, HostAllocator::GetCallbacks());
 
-    // destroy the swap chain before the device
-    vkDestroySwapchainKHR(m_logicalDevice, m_swapChain, nullptr);
-    vkDestroyRenderPass(m_logicalDevice, m_renderPass, nullptr);
+    // all the buffers and images are destroyed, free the memory blocks
+    m_memoryAllocator.Destroy(m_logicalDevice);
 
     // destroy the logical device
-    vkDestroyDevice(m_logicalDevice, nullptr);
+    vkDestroyDevice(m_logicalDevice, HostAllocator::GetCallbacks());
     if (m_enableValidationLayers)
     {
-        DestroyDebugUtilsMessengerEXT(m_Instance, m_debugMessenger, nullptr);
+        DestroyDebugUtilsMessengerEXT(m_Instance, m_debugMessenger, HostAllocator::GetCallbacks());
+    }
+    if (!m_headless) {
+        vkDestroySurfaceKHR(m_Instance, m_windowSurface, HostAllocator::GetCallbacks());
+    }
+    vkDestroyInstance(m_Instance, HostAllocator::GetCallbacks());
+    if (m_trackHostAllocations) {
+        m_hostAllocator.PrintStatistics(std::cout);
+        m_hostAllocator.Destroy();
+    }
+    if (!m_headless) {
+        glfwDestroyWindow(m_window);
+        glfwTerminate();
     }
-    vkDestroySurfaceKHR(m_Instance, m_windowSurface, nullptr);
-    vkDestroyInstance(m_Instance, nullptr);
-    glfwDestroyWindow(m_window);
-    glfwTerminate();
 }
 
 void BasicApplication::InitWindow(int windowWidth, int windowHeight, const char* windowName) {
     m_windowWidth = windowWidth;
     m_windowHeight = windowHeight;
+    // the window size is only used as the render target size in headless mode
+    if (m_headless) {return;}
 
     glfwInit();
 
     glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
-    glfwWindowHint(GLFW_RESIZABLE, GLFW_FALSE);
+    glfwWindowHint(GLFW_RESIZABLE, GLFW_TRUE);
 
     m_window = glfwCreateWindow(m_windowWidth, m_windowHeight, windowName, nullptr, nullptr);
+    // make the application reachable from the window callbacks
+    glfwSetWindowUserPointer(m_window, this);
+    glfwSetKeyCallback(m_window, KeyCallBack);
+    glfwSetFramebufferSizeCallback(m_window, FramebufferResizeCallBack);
+}
+
+void BasicApplication::FramebufferResizeCallBack(GLFWwindow *window, int width, int height) {
+    auto application = reinterpret_cast<BasicApplication*>(glfwGetWindowUserPointer(window));
+    // the driver is not guaranteed to report VK_ERROR_OUT_OF_DATE_KHR after resizing
+    application->m_framebufferResized = true;
+}
+
+void BasicApplication::KeyCallBack(GLFWwindow *window, int key, int scancode, int action, int mods) {
+    auto application = reinterpret_cast<BasicApplication*>(glfwGetWindowUserPointer(window));
+    // T: print the CPU and GPU frame timings
+    if (key == GLFW_KEY_T && action == GLFW_PRESS) {
+        application->PrintFrameTimings();
+        application->PrintGpuTimings();
+        application->PrintFramePacing();
+    }
+    // P: switch to the next present policy
+    if (key == GLFW_KEY_P && action == GLFW_PRESS) {
+        PresentPolicy policy = FramePacer::GetNextPolicy(application->m_presentPolicy);
+        double targetFps = application->m_framePacer.GetTargetFps() > 0.0 ? application->m_framePacer.GetTargetFps() : 60.0;
+        application->SetPresentPolicy(policy, targetFps);
+    }
 }
 
 void  BasicApplication::InitVulkan() {
@@ -74,15 +274,37 @@ void  BasicApplication::InitVulkan() {
     SetupDebugMessenger();
 
     // create window surface (must before physical device pickup)
-    CreateWindowSurface();
+    if (!m_headless) {
+        CreateWindowSurface();
+    }
 
     // select physical device to use
     PickPhysicalDevice();
 
     CreateLogicalDevice();
 
-    // create swap chain
-    CreateSwapChain();
+    // buffers and images are sub-allocated from blocks of device memory
+    m_memoryAllocator.Create(m_Instance, m_physicalDevice, m_memoryBudgetEnabled);
+    // vertex, index and uniform data is written in place when the host can write device local memory
+    if (m_printStatistics) {
+        std::cout << "Device memory: " << (m_memoryAllocator.GetHeapClassification().unifiedMemory ? "unified" : "discrete")
+                  << ", direct uploads up to " << m_memoryAllocator.GetMaxDirectUploadSize() / (1024 * 1024) << " MB" << std::endl;
+    }
+    // uniform data of all the objects, one region for each frame in flight
+    m_uniformRing.Create(m_logicalDevice, m_physicalDevice, m_memoryAllocator, m_framesInFlight, INITIAL_UNIFORM_RING_OBJECTS * sizeof(UniformBufferObject));
+    // staging memory of the vertex, index and texture uploads
+    m_stagingArena.Create(m_logicalDevice, m_memoryAllocator, STAGING_CHUNK_SIZE);
+    // pipelines compiled by the previous run, if the file matches this device and driver
+    m_pipelineCache.Create(m_logicalDevice, m_physicalDevice, m_pipelineCacheFile);
+    m_pipelineRegistry.Create(m_logicalDevice, m_pipelineCache, m_shaderLibrary);
+
+    // create swap chain, or the images to render to in headless mode
+    if (m_headless) {
+        CreateHeadlessImages();
+    } else {
+        CreateSwapChain();
+    }
+    UpdateViews();
 
     // create image views
     CreateImageViewsForSwapChain();
@@ -93,19 +315,68 @@ void  BasicApplication::InitVulkan() {
     // create frame buffers
     CreateFrameBuffers();
 
-    // command pool
-    CreateCommandPool();
+    // uploads of the objects and textures are batched on the graphics queue
+    const QueueFamilyIndices& indices = FindQueueFamilies(m_physicalDevice);
+    if (m_transferQueueEnabled) {
+        m_uploadContext.Create(m_logicalDevice, indices.queueFamilyIndexForTransfer.value(), m_transferQueue,
+                               indices.queueFamilyIndexForDrawing.value(), m_timelineSemaphoreEnabled);
+    } else {
+        m_uploadContext.Create(m_logicalDevice, indices.queueFamilyIndexForDrawing.value(), m_graphicsQueue,
+                               indices.queueFamilyIndexForDrawing.value(), m_timelineSemaphoreEnabled);
+    }
+    // shared by the upload and graphics queue families when uploading on the transfer queue
+    m_geometryPool.Create(m_logicalDevice, m_memoryAllocator, INITIAL_GEOMETRY_POOL_VERTICES, INITIAL_GEOMETRY_POOL_INDICES,
+                          m_uploadContext.GetConcurrentQueueFamilies());
+
+    CreateSyncObjects();
 
-    CreateSemaphores();
+    // command pools of the frames in flight
+    CreateFrameCommandPools();
 }
 
-void BasicApplication::MainLoop() {
-    while (!glfwWindowShouldClose(m_window)){
+void BasicApplication::MainLoop(uint32_t frameCount) {
+    // the pipelines of the objects added before running are compiled together on the worker threads
+    m_pipelineRegistry.CompilePending(m_logicalDevice, m_recordingThreads);
+    auto startTime = std::chrono::high_resolution_clock::now();
+    // from InitialApplication to the first frame, including the pipelines of the objects added so far
+    m_startupTime = std::chrono::duration<double, std::milli>(startTime - m_startupBeginTime).count();
+    if (m_printStatistics) {
+        std::cout << "Startup: " << m_startupTime << " ms" << std::endl;
+        m_pipelineCache.PrintStatistics(std::cout);
+        m_pipelineRegistry.PrintStatistics(std::cout);
+        m_shaderLibrary.PrintStatistics(std::cout);
+    }
+    uint64_t drawnFrames = 0;
+    m_framesPerSecond = 0.0;
+    uint64_t hostAllocationCalls = m_trackHostAllocations ? m_hostAllocator.GetCallCount() : 0;
+    while ((m_headless || !glfwWindowShouldClose(m_window)) && (frameCount == 0 || drawnFrames < frameCount)){
         // Update events from user
-        glfwPollEvents();
+        if (!m_headless) {
+            glfwPollEvents();
+        }
+        if (m_frameCallback) {
+            m_frameCallback(drawnFrames);
+        }
         DrawFrame();
+        // frame limiter, and frame-to-frame interval measurement
+        m_framePacer.Pace();
+        ++drawnFrames;
     }
     vkDeviceWaitIdle(m_logicalDevice);
+
+    // frame throughput, including the frames still in flight when the loop ends
+    auto endTime = std::chrono::high_resolution_clock::now();
+    float seconds = std::chrono::duration<float, std::chrono::seconds::period>(endTime - startTime).count();
+    if (drawnFrames > 0 && seconds > 0.f) {
+        m_framesPerSecond = drawnFrames / seconds;
+        std::cout << "Drew " << drawnFrames << " frames in " << seconds << " s (" << drawnFrames / seconds
+                  << " fps, " << m_framesInFlight << " frames in flight)" << std::endl;
+    }
+    // driver allocations on the per-frame path (command buffer recording, submission, presentation)
+    if (m_trackHostAllocations && drawnFrames > 0) {
+        hostAllocationCalls = m_hostAllocator.GetCallCount() - hostAllocationCalls;
+        std::cout << "Vulkan host allocations: " << static_cast<double>(hostAllocationCalls) / drawnFrames << " per frame" << std::endl;
+    }
 }
 
 
@@ -117,7 +388,14 @@ void BasicApplication::CreateVulkanInstance() {
     appInfo.applicationVersion = VK_MAKE_VERSION(1,0,0);
     appInfo.pEngineName = "No Engine";
     appInfo.engineVersion = VK_MAKE_VERSION(1,0,0);
-    appInfo.apiVersion = VK_API_VERSION_1_0;
+    // timeline semaphores are core in 1.2, a 1.0 loader doesn't have vkEnumerateInstanceVersion and rejects higher versions
+    auto enumerateInstanceVersion = (PFN_vkEnumerateInstanceVersion) vkGetInstanceProcAddr(nullptr, "vkEnumerateInstanceVersion");
+    m_instanceApiVersion = VK_API_VERSION_1_0;
+    if (enumerateInstanceVersion != nullptr) {
+        enumerateInstanceVersion(&m_instanceApiVersion);
+    }
+    m_instanceApiVersion = std::min<uint32_t>(m_instanceApiVersion, VK_API_VERSION_1_2);
+    appInfo.apiVersion = m_instanceApiVersion;
 
     // tell the vulkan driver which global extensions and validation layers we want to use
     VkInstanceCreateInfo createInfo{};
@@ -151,7 +429,7 @@ void BasicApplication::CreateVulkanInstance() {
 
 
     // create vulkan instance (m_instance based on the VkInstanceCreateInfo)
-    if (vkCreateInstance(&createInfo, nullptr, &m_Instance) != VK_SUCCESS)
+    if (vkCreateInstance(&createInfo, HostAllocator::GetCallbacks(), &m_Instance) != VK_SUCCESS)
     {
         throw std::runtime_error("Failed to create instance");
     }
@@ -173,11 +451,14 @@ const std::vector<const char*> BasicApplication::GetVulkanSupportedExtensionName
 }
 
 const std::vector<const char *> BasicApplication::GetGlfwRequiredExtensionNames() {
-    uint32_t glfwExtensionCount = 0;
-    // extension to make vulkan interface with the window system
-    // GLFW returns the extensions it needs to interface
-    const char** glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
-    std::vector<const char*> glfwExtensionNames(glfwExtensions, glfwExtensions+glfwExtensionCount);
+    std::vector<const char*> glfwExtensionNames;
+    if (!m_headless) {
+        uint32_t glfwExtensionCount = 0;
+        // extension to make vulkan interface with the window system
+        // GLFW returns the extensions it needs to interface
+        const char** glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
+        glfwExtensionNames.assign(glfwExtensions, glfwExtensions+glfwExtensionCount);
+    }
     if (m_enableValidationLayers)
     {
         glfwExtensionNames.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
@@ -267,7 +548,7 @@ void BasicApplication::SetupDebugMessenger() {
             VK_DEBUG_UTILS_MESSAGE_TYPE_PERFORMANCE_BIT_EXT;
     debugCreateInfo.pfnUserCallback = DebugCallBack;
     debugCreateInfo.pUserData = nullptr;
-    if (CreateDebugUtilsMessengerEXT(m_Instance, &debugCreateInfo, nullptr, &m_debugMessenger) != VK_SUCCESS)
+    if (CreateDebugUtilsMessengerEXT(m_Instance, &debugCreateInfo, HostAllocator::GetCallbacks(), &m_debugMessenger) != VK_SUCCESS)
     {
         throw std::runtime_error("Failed to set up debug messenger!");
     }
@@ -348,8 +629,8 @@ bool BasicApplication::IsPhysicalDeviceSuitable(VkPhysicalDevice const &device)
     // check if device extensions are supported
     bool isExtensionSupported = CheckDeviceExtensions(device);
     // check if the swap chain support is sufficient for the application
-    bool isSwapChainAdequate = false;
-    if (isExtensionSupported)
+    bool isSwapChainAdequate = m_headless;
+    if (isExtensionSupported && !m_headless)
     {
         SwapChainSupportDetails swapChainSupport = GetSwapChainSupportDetails(device);
         isSwapChainAdequate = !swapChainSupport.surfaceFormats.empty() && !swapChainSupport.presentModes.empty();
@@ -371,7 +652,9 @@ QueueFamilyIndices BasicApplication::FindQueueFamilies(const VkPhysicalDevice& p
     for(VkQueueFamilyProperties family : queueFamilies)
     {
         isFamilySupportPresentation = false;
-        vkGetPhysicalDeviceSurfaceSupportKHR(physicalDevice, queueFamilyIndex, m_windowSurface, &isFamilySupportPresentation);
+        if (!m_headless) {
+            vkGetPhysicalDeviceSurfaceSupportKHR(physicalDevice, queueFamilyIndex, m_windowSurface, &isFamilySupportPresentation);
+        }
         if (isFamilySupportPresentation)
         {
             familyIndices.queueFamilyIndexForPresenting = queueFamilyIndex;
@@ -379,10 +662,23 @@ QueueFamilyIndices BasicApplication::FindQueueFamilies(const VkPhysicalDevice& p
         if (family.queueFlags & VK_QUEUE_GRAPHICS_BIT)
         {
             familyIndices.queueFamilyIndexForDrawing = queueFamilyIndex;
+            // nothing is presented in headless mode, the "present" queue is the graphics queue
+            if (m_headless) {
+                familyIndices.queueFamilyIndexForPresenting = queueFamilyIndex;
+            }
         }
         if (familyIndices.IsComplete()) {break;}
         ++queueFamilyIndex;
     }
+    // find a transfer-only queue family (the DMA engine), preferably without compute
+    for (uint32_t index = 0; index < queueFamilyCount; ++index)
+    {
+        VkQueueFlags flags = queueFamilies[index].queueFlags;
+        if (!(flags & VK_QUEUE_TRANSFER_BIT) || (flags & VK_QUEUE_GRAPHICS_BIT)) {continue;}
+        if (!familyIndices.queueFamilyIndexForTransfer.has_value() || !(flags & VK_QUEUE_COMPUTE_BIT)) {
+            familyIndices.queueFamilyIndexForTransfer = index;
+        }
+    }
    return familyIndices;
 }
 
@@ -393,6 +689,13 @@ void BasicApplication::CreateLogicalDevice() {
     // different queueCreateInfo for different queue family
     std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
     std::set<uint32_t> uniqueQueueFamilies = {indices.queueFamilyIndexForDrawing.value(), indices.queueFamilyIndexForPresenting.value()};
+    // the graphics queue waits for the uploads with the timeline semaphore of the transfer queue
+    m_timelineSemaphoreEnabled = m_preferTimelineSemaphore &&
+            GpuTimeline::IsTimelineSemaphoreSupported(m_Instance, m_physicalDevice, m_instanceApiVersion);
+    m_transferQueueEnabled = m_preferTransferQueue && m_timelineSemaphoreEnabled && indices.queueFamilyIndexForTransfer.has_value();
+    if (m_transferQueueEnabled) {
+        uniqueQueueFamilies.insert(indices.queueFamilyIndexForTransfer.value());
+    }
     float queuePriority = 1.0f;
 
     for (uint32_t familyIndex : uniqueQueueFamilies)
@@ -418,10 +721,28 @@ void BasicApplication::CreateLogicalDevice() {
     deviceCreateInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size());
     deviceCreateInfo.pEnabledFeatures = &physicalDeviceFeatures;
 
-    deviceCreateInfo.enabledExtensionCount =static_cast<uint32_t> (m_deviceExtensions.size());
-    deviceCreateInfo.ppEnabledExtensionNames = m_deviceExtensions.data();
+    // timeline semaphore for the frame synchronization, fences are used if it's not supported
+    VkPhysicalDeviceTimelineSemaphoreFeatures timelineFeatures{};
+    timelineFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES;
+    timelineFeatures.timelineSemaphore = VK_TRUE;
+    if (m_timelineSemaphoreEnabled) {
+        deviceCreateInfo.pNext = &timelineFeatures;
+    }
+    if (m_printStatistics) {
+        std::cout << "Frame synchronization: " << (m_timelineSemaphoreEnabled ? "timeline semaphore" : "fences") << std::endl;
+        std::cout << "Uploads: " << (m_transferQueueEnabled ? "transfer queue" : "graphics queue") << std::endl;
+    }
 
-    if (vkCreateDevice(m_physicalDevice, &deviceCreateInfo, nullptr, &m_logicalDevice) != VK_SUCCESS)
+    // the memory budget is only reported, so the extension is optional
+    std::vector<const char*> deviceExtensions = m_deviceExtensions;
+    m_memoryBudgetEnabled = DeviceMemoryAllocator::IsMemoryBudgetSupported(m_physicalDevice, m_instanceApiVersion);
+    if (m_memoryBudgetEnabled) {
+        deviceExtensions.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+    }
+    deviceCreateInfo.enabledExtensionCount =static_cast<uint32_t> (deviceExtensions.size());
+    deviceCreateInfo.ppEnabledExtensionNames = deviceExtensions.data();
+
+    if (vkCreateDevice(m_physicalDevice, &deviceCreateInfo, HostAllocator::GetCallbacks(), &m_logicalDevice) != VK_SUCCESS)
     {
         throw std::runtime_error("Failed to create logical device");
     }
@@ -432,10 +753,15 @@ void BasicApplication::CreateLogicalDevice() {
 
     //Retrieve the present queue for present operations
     vkGetDeviceQueue(m_logicalDevice, indices.queueFamilyIndexForPresenting.value(), 0, &m_presentQueue);
+
+    //Retrieve the transfer queue for uploads
+    if (m_transferQueueEnabled) {
+        vkGetDeviceQueue(m_logicalDevice, indices.queueFamilyIndexForTransfer.value(), 0, &m_transferQueue);
+    }
 }
 
 void BasicApplication::CreateWindowSurface() {
-    if (glfwCreateWindowSurface(m_Instance, m_window, nullptr, &m_windowSurface) != VK_SUCCESS)
+    if (glfwCreateWindowSurface(m_Instance, m_window, HostAllocator::GetCallbacks(), &m_windowSurface) != VK_SUCCESS)
     {
         throw std::runtime_error("Failed to create window surface");
     }
@@ -477,19 +803,30 @@ VkSurfaceFormatKHR BasicApplication::PickSwapSurfaceFormat(const std::vector<VkS
     return availableFormats[0];
 }
 
+std::vector<VkPresentModeKHR> BasicApplication::GetPreferredPresentModes(PresentPolicy policy) {
+    switch (policy) {
+        case PresentPolicy::LowLatency:
+        case PresentPolicy::TargetFps:
+            return {VK_PRESENT_MODE_MAILBOX_KHR, VK_PRESENT_MODE_IMMEDIATE_KHR};
+        case PresentPolicy::VSync:
+            break;
+        case PresentPolicy::Uncapped:
+            return {VK_PRESENT_MODE_IMMEDIATE_KHR, VK_PRESENT_MODE_MAILBOX_KHR};
+        case PresentPolicy::Count:
+            break;
+    }
+    return {};
+}
+
 VkPresentModeKHR BasicApplication::PickSwapPresentMode(const std::vector<VkPresentModeKHR> &availablePresentModes) {
-    // the best one is VK_PRESENT_MODE_MAILBOX_KHR, the next is VK_PRESENT_MODE_FIFO_KHR
-    for (const auto& availablePresentMode : availablePresentModes) {
-        if (availablePresentMode == VK_PRESENT_MODE_MAILBOX_KHR) {
-            return availablePresentMode;
-        }
-        else if (availablePresentMode == VK_PRESENT_MODE_FIFO_KHR)
-        {
-            return availablePresentMode;
+    // preferred present modes of the policy, in order (the order of the driver's list doesn't matter)
+    for (VkPresentModeKHR preferredMode : GetPreferredPresentModes(m_presentPolicy)) {
+        if (std::find(availablePresentModes.begin(), availablePresentModes.end(), preferredMode) != availablePresentModes.end()) {
+            return preferredMode;
         }
     }
-    // if not found the best one, then
-    return VK_PRESENT_MODE_IMMEDIATE_KHR;
+    // VK_PRESENT_MODE_FIFO_KHR is always supported
+    return VK_PRESENT_MODE_FIFO_KHR;
 }
 
 VkExtent2D BasicApplication::PickSwapExtent(const VkSurfaceCapabilitiesKHR &capabilities) {
@@ -506,7 +843,7 @@ VkExtent2D BasicApplication::PickSwapExtent(const VkSurfaceCapabilitiesKHR &capa
     }
 }
 
-void BasicApplication::CreateSwapChain() {
+void BasicApplication::CreateSwapChain(VkSwapchainKHR oldSwapChain) {
     SwapChainSupportDetails swapChainSupport = GetSwapChainSupportDetails(m_physicalDevice);
 
     VkSurfaceFormatKHR surfaceFormat = PickSwapSurfaceFormat(swapChainSupport.surfaceFormats);
@@ -545,10 +882,11 @@ void BasicApplication::CreateSwapChain() {
     createInfo.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
     createInfo.presentMode = presentMode;
     createInfo.clipped = VK_TRUE;
-    createInfo.oldSwapchain = VK_NULL_HANDLE;
+    // the old swap chain is retired, its images that are still being presented stay valid
+    createInfo.oldSwapchain = oldSwapChain;
 
     // Create!
-    if (vkCreateSwapchainKHR(m_logicalDevice, &createInfo, nullptr, &m_swapChain) != VK_SUCCESS) {
+    if (vkCreateSwapchainKHR(m_logicalDevice, &createInfo, HostAllocator::GetCallbacks(), &m_swapChain) != VK_SUCCESS) {
         throw std::runtime_error("Failed to create swap chain!");
     }
 
@@ -562,6 +900,82 @@ void BasicApplication::CreateSwapChain() {
     m_swapChainExtent = extent;
 }
 
+void BasicApplication::CleanupSwapChain() {
+    for (auto framebuffer : m_swapChainFrameBuffers) {
+        vkDestroyFramebuffer(m_logicalDevice, framebuffer, HostAllocator::GetCallbacks());
+    }
+    m_swapChainFrameBuffers.clear();
+
+    for (VkImageView imageView : m_swapChainImageViews) {
+        vkDestroyImageView(m_logicalDevice, imageView, HostAllocator::GetCallbacks());
+    }
+    m_swapChainImageViews.clear();
+}
+
+void BasicApplication::RecreateSwapChain() {
+    // a minimized window has a zero sized framebuffer, wait until it can be drawn again
+    int width = 0, height = 0;
+    glfwGetFramebufferSize(m_window, &width, &height);
+    while (width == 0 || height == 0) {
+        glfwWaitEvents();
+        glfwGetFramebufferSize(m_window, &width, &height);
+    }
+    m_windowWidth = static_cast<uint32_t>(width);
+    m_windowHeight = static_cast<uint32_t>(height);
+    auto startTime = std::chrono::high_resolution_clock::now();
+
+    // the GPU must not use the old frame buffers any more,
+    // presentation is not tracked by the timeline, so the present queue is waited for the old swap chain
+    m_graphicsTimeline.WaitIdle(m_logicalDevice);
+    vkQueueWaitIdle(m_presentQueue);
+
+    VkFormat oldImageFormat = m_swapChainImageFormat;
+    CleanupSwapChain();
+    VkSwapchainKHR oldSwapChain = m_swapChain;
+    CreateSwapChain(oldSwapChain);
+    vkDestroySwapchainKHR(m_logicalDevice, oldSwapChain, HostAllocator::GetCallbacks());
+    // the render pass and the pipelines are kept, so the format must not change
+    if (m_swapChainImageFormat != oldImageFormat) {
+        throw std::runtime_error("Failed to recreate swap chain with the same image format!");
+    }
+    CreateImageViewsForSwapChain();
+    CreateFrameBuffers();
+    UpdateViews();
+
+    // the objects keep their vertex/index buffers, textures and pipelines (viewport and scissor are dynamic)
+    // the uniform ring and descriptor sets are per frame in flight, so they don't depend on the number of images
+    for (BaseObject* object : m_objects) {
+        object->SetViewExtent(GetViewExtent());
+    }
+    // none of the new images is in use
+    m_imagesInFlight.assign(m_swapChainImages.size(), 0);
+
+    // the command buffers are recorded every frame, so they pick up the new frame buffers and extent
+    m_framebufferResized = false;
+    m_presentModeChanged = false;
+
+    auto endTime = std::chrono::high_resolution_clock::now();
+    if (m_printStatistics) {
+        std::cout << "Recreated swap chain (" << m_swapChainExtent.width << "x" << m_swapChainExtent.height << ") in "
+                  << std::chrono::duration<float, std::chrono::milliseconds::period>(endTime - startTime).count() << " ms" << std::endl;
+    }
+}
+
+void BasicApplication::CreateHeadlessImages() {
+    // same format as the preferred swap chain format, so pipelines behave the same as in windowed mode
+    m_swapChainImageFormat = VK_FORMAT_B8G8R8A8_SRGB;
+    m_swapChainExtent = {m_windowWidth, m_windowHeight};
+
+    m_swapChainImages.resize(m_headlessImageCount);
+    m_headlessImagesMemory.resize(m_headlessImageCount);
+    for (size_t i = 0; i < m_headlessImageCount; i++) {
+        // transfer source, so the rendered images can be copied out for batch rendering
+        VulkanHelperFunctions::CreateImage(m_logicalDevice, m_memoryAllocator, m_swapChainExtent.width, m_swapChainExtent.height, m_swapChainImageFormat,
+                                           VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
+                                           VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, MemoryCategory::Swapchain, m_swapChainImages[i], m_headlessImagesMemory[i]);
+    }
+}
+
 void BasicApplication::CreateImageViewsForSwapChain() {
     m_swapChainImageViews.resize(m_swapChainImages.size());
     for (size_t i = 0; i < m_swapChainImages.size(); ++i) {
@@ -579,7 +993,8 @@ void BasicApplication::CreateRenderPass() {
     colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
     colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
     colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-    colorAttachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+    // headless images are never presented, leave them ready to be copied out
+    colorAttachment.finalLayout = m_headless ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
 
     // subpass, post-processing after render process
     VkAttachmentReference colorAttachmentRef = {};
@@ -609,7 +1024,7 @@ void BasicApplication::CreateRenderPass() {
     renderPassInfo.dependencyCount = 1;
     renderPassInfo.pDependencies = &dependency;
 
-    if (vkCreateRenderPass(m_logicalDevice, &renderPassInfo, nullptr, &m_renderPass) != VK_SUCCESS) {
+    if (vkCreateRenderPass(m_logicalDevice, &renderPassInfo, HostAllocator::GetCallbacks(), &m_renderPass) != VK_SUCCESS) {
         throw std::runtime_error("Failed to create render pass!");
     }
 }
@@ -630,179 +1045,486 @@ void BasicApplication::CreateFrameBuffers() {
         framebufferInfo.height = m_swapChainExtent.height;
         framebufferInfo.layers = 1;
 
-        if (vkCreateFramebuffer(m_logicalDevice, &framebufferInfo, nullptr, &m_swapChainFrameBuffers[i]) != VK_SUCCESS) {
+        if (vkCreateFramebuffer(m_logicalDevice, &framebufferInfo, HostAllocator::GetCallbacks(), &m_swapChainFrameBuffers[i]) != VK_SUCCESS) {
             throw std::runtime_error("Failed to create framebuffer!");
         }
     }
 }
 
-void BasicApplication::CreateCommandPool() {
+void BasicApplication::UpdateViews() {
+    // side by side columns of the same width, the last one takes the remaining pixels
+    uint32_t viewWidth = std::max<uint32_t>(m_swapChainExtent.width / m_viewCount, 1);
+    m_views.resize(m_viewCount);
+    for (uint32_t i = 0; i < m_viewCount; i++) {
+        int32_t offsetX = static_cast<int32_t>(std::min(i * viewWidth, m_swapChainExtent.width - 1));
+        uint32_t width = i + 1 < m_viewCount ? viewWidth : m_swapChainExtent.width - static_cast<uint32_t>(offsetX);
+        RenderView& view = m_views[i];
+        view.viewport.x = (float) offsetX;
+        view.viewport.y = 0.0f;
+        view.viewport.width = (float) width;
+        view.viewport.height = (float) m_swapChainExtent.height;
+        view.viewport.minDepth = 0.0f;
+        view.viewport.maxDepth = 1.0f;
+        view.scissor.offset = {offsetX, 0};
+        view.scissor.extent = {width, m_swapChainExtent.height};
+    }
+}
+
+void BasicApplication::CreateFrameCommandPools() {
     QueueFamilyIndices queueFamilyIndices = FindQueueFamilies(m_physicalDevice);
+    uint32_t workerCount = m_recordingThreads.GetWorkerCount();
+    m_frameCommandPools.resize(m_framesInFlight);
+    m_frameCommandBuffers.resize(m_framesInFlight);
+    m_secondaryCommandPools.assign(m_framesInFlight, std::vector<VkCommandPool>(workerCount));
+    m_secondaryCommandBuffers.assign(m_framesInFlight, std::vector<VkCommandBuffer>(workerCount));
 
+    // the command buffers are short-lived, the pool is reset as a whole instead of each command buffer
     VkCommandPoolCreateInfo poolInfo = {};
     poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
     poolInfo.queueFamilyIndex = queueFamilyIndices.queueFamilyIndexForDrawing.value();
-    poolInfo.flags = 0;
-    if (vkCreateCommandPool(m_logicalDevice, &poolInfo, nullptr, &m_commandPool) != VK_SUCCESS) {
-        throw std::runtime_error("Failed to create command pool!");
+    poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+    VkCommandBufferAllocateInfo allocInfo = {};
+    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    allocInfo.commandBufferCount = 1;
+
+    for (size_t i = 0; i < m_framesInFlight; i++) {
+        if (vkCreateCommandPool(m_logicalDevice, &poolInfo, HostAllocator::GetCallbacks(), &m_frameCommandPools[i]) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to create command pool!");
+        }
+        allocInfo.commandPool = m_frameCommandPools[i];
+        allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        if (vkAllocateCommandBuffers(m_logicalDevice, &allocInfo, &m_frameCommandBuffers[i]) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to allocate command buffers!");
+        }
+
+        // a secondary command buffer for each recording task
+        for (uint32_t worker = 0; worker < workerCount; worker++) {
+            if (vkCreateCommandPool(m_logicalDevice, &poolInfo, HostAllocator::GetCallbacks(), &m_secondaryCommandPools[i][worker]) != VK_SUCCESS) {
+                throw std::runtime_error("Failed to create command pool!");
+            }
+            allocInfo.commandPool = m_secondaryCommandPools[i][worker];
+            allocInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+            if (vkAllocateCommandBuffers(m_logicalDevice, &allocInfo, &m_secondaryCommandBuffers[i][worker]) != VK_SUCCESS) {
+                throw std::runtime_error("Failed to allocate command buffers!");
+            }
+        }
     }
 }
 
-void BasicApplication::CreateCommandBuffers() {
-    m_commandBuffers.resize(m_swapChainFrameBuffers.size());
-    VkCommandBufferAllocateInfo allocInfo = {};
-    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-    allocInfo.commandPool = m_commandPool;
-    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-    allocInfo.commandBufferCount = (uint32_t) m_commandBuffers.size();
-
-    if (vkAllocateCommandBuffers(m_logicalDevice, &allocInfo, m_commandBuffers.data()) != VK_SUCCESS) {
-        throw std::runtime_error("Failed to allocate command buffers!");
-    }
-    // record the commands in command buffers
-    for (size_t i = 0; i < m_commandBuffers.size(); i++) {
-        // begin recording
-        VkCommandBufferBeginInfo beginInfo = {};
-        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-        beginInfo.flags = VK_COMMAND_BUFFER_USAGE_SIMULTANEOUS_USE_BIT;
-        beginInfo.pInheritanceInfo = nullptr; // Optional
-        if (vkBeginCommandBuffer(m_commandBuffers[i], &beginInfo) != VK_SUCCESS) {
-            throw std::runtime_error("Failed to begin recording command buffer!");
+void BasicApplication::DestroyFrameCommandPools() {
+    // the command buffers are freed with their pools
+    for (VkCommandPool commandPool : m_frameCommandPools) {
+        vkDestroyCommandPool(m_logicalDevice, commandPool, HostAllocator::GetCallbacks());
+    }
+    for (const auto& commandPools : m_secondaryCommandPools) {
+        for (VkCommandPool commandPool : commandPools) {
+            vkDestroyCommandPool(m_logicalDevice, commandPool, HostAllocator::GetCallbacks());
         }
+    }
+    m_frameCommandPools.clear();
+    m_frameCommandBuffers.clear();
+    m_secondaryCommandPools.clear();
+    m_secondaryCommandBuffers.clear();
+}
 
-        // record render pass
-        VkRenderPassBeginInfo renderPassInfo = {};
-        renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-        renderPassInfo.renderPass = m_renderPass;
-        renderPassInfo.framebuffer = m_swapChainFrameBuffers[i];
-        renderPassInfo.renderArea.offset = {0, 0};
-        renderPassInfo.renderArea.extent = m_swapChainExtent;
-        VkClearValue clearColor = {0.0f, 0.0f, 0.0f, 1.0f};
-        renderPassInfo.clearValueCount = 1;
-        renderPassInfo.pClearValues = &clearColor;
-        vkCmdBeginRenderPass(m_commandBuffers[i], &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
-
-        // loop each object
-        for(BaseObject* object : m_objects)
-        {
-            // bind the graphics pipeline
-            vkCmdBindPipeline(m_commandBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, object->m_graphicsPipeline);
-            // bind the vertex buffer
-            VkBuffer vertexBuffers_rec[] = {object->m_vertexBuffer};
-            VkDeviceSize offsets_rec[] = {0};
-            vkCmdBindVertexBuffers(m_commandBuffers[i], 0, 1, vertexBuffers_rec, offsets_rec);
-            // bind the index buffer
-            vkCmdBindIndexBuffer(m_commandBuffers[i], object->m_indexBuffer, 0, VK_INDEX_TYPE_UINT32);
-            // bind the descriptor set for each swap chain image to the descriptors in the shader with vkCmdBindDescriptorSets (before the vkCmdDrawIndexed)
-            vkCmdBindDescriptorSets(m_commandBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, object->m_pipelineLayout, 0, 1, &object->m_descriptorSets[i], 0, nullptr);
-            // draw the object
-            vkCmdDrawIndexed(m_commandBuffers[i], static_cast<uint32_t>(object->m_indices.size()), 1, 0, 0, 0);
+void BasicApplication::UpdateGpuProfilerCapacity(uint32_t scopeCount) {
+    if (!m_enableGpuProfiler || scopeCount <= m_gpuProfiler.GetScopeCapacity()) {return;}
+    // the query pool is still used by the frames in flight, the timings collected so far are kept
+    m_graphicsTimeline.WaitIdle(m_logicalDevice);
+    for (uint32_t i = 0; i < m_framesInFlight; i++) {
+        m_gpuProfiler.Resolve(m_logicalDevice, i);
+    }
+    m_gpuProfiler.Destroy(m_logicalDevice);
+    // grow geometrically, so that adding objects one by one doesn't recreate the pool every frame
+    uint32_t scopeCapacity = std::max(scopeCount, m_gpuProfiler.GetScopeCapacity() * 2);
+    QueueFamilyIndices queueFamilyIndices = FindQueueFamilies(m_physicalDevice);
+    m_gpuProfiler.Create(m_logicalDevice, m_physicalDevice, queueFamilyIndices.queueFamilyIndexForDrawing.value(),
+                         m_framesInFlight, scopeCapacity);
+    // don't try again every frame if the queue doesn't support timestamps
+    m_enableGpuProfiler = m_gpuProfiler.IsEnabled();
+}
+
+void BasicApplication::RecordCommandBuffer(uint32_t imageIndex) {
+    // timestamp scopes: the render pass, then each object (only rebuilt when objects are added or removed)
+    if (m_enableGpuProfiler && m_gpuScopeNames.size() != m_objects.size() + 1) {
+        m_gpuScopeNames = {"render pass"};
+        for (BaseObject* object : m_objects) {
+            m_gpuScopeNames.push_back(object->GetName());
         }
+        UpdateGpuProfilerCapacity(static_cast<uint32_t>(m_gpuScopeNames.size()));
+    }
 
-        // end render pass
-        vkCmdEndRenderPass(m_commandBuffers[i]);
+    // the GPU has finished the previous submission of this frame, so all its command buffers can be reset at once
+    vkResetCommandPool(m_logicalDevice, m_frameCommandPools[m_currentFrame], 0);
+    VkCommandBuffer commandBuffer = m_frameCommandBuffers[m_currentFrame];
+
+    // begin recording, the command buffer is submitted once before it is reset
+    VkCommandBufferBeginInfo beginInfo = {};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    beginInfo.pInheritanceInfo = nullptr; // Optional
+    if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to begin recording command buffer!");
+    }
 
-        // end recording
-        if (vkEndCommandBuffer(m_commandBuffers[i]) != VK_SUCCESS) {
-            throw std::runtime_error("Failed to record command buffer!");
+    // uploads from the transfer queue are acquired outside of the render pass, the submission waits for them
+    m_frameUploadWaitValue = m_uploadContext.CmdAcquireUploads(commandBuffer);
+
+    // queries are reset outside of the render pass
+    m_gpuProfiler.CmdResetRegion(commandBuffer, m_currentFrame, m_gpuScopeNames);
+    m_gpuProfiler.CmdBeginScope(commandBuffer, m_currentFrame, 0);
+
+    // record render pass
+    VkRenderPassBeginInfo renderPassInfo = {};
+    renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+    renderPassInfo.renderPass = m_renderPass;
+    renderPassInfo.framebuffer = m_swapChainFrameBuffers[imageIndex];
+    renderPassInfo.renderArea.offset = {0, 0};
+    renderPassInfo.renderArea.extent = m_swapChainExtent;
+    VkClearValue clearColor = {0.0f, 0.0f, 0.0f, 1.0f};
+    renderPassInfo.clearValueCount = 1;
+    renderPassInfo.pClearValues = &clearColor;
+    // split the objects into one secondary command buffer for each task, if there are enough of them
+    uint32_t objectCount = static_cast<uint32_t>(m_objects.size());
+    uint32_t taskCount = std::min(m_recordingThreads.GetWorkerCount(), objectCount / m_minObjectsPerRecordingThread);
+    if (taskCount <= 1) {
+        vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+        RecordObjectDraws(commandBuffer, 0, objectCount);
+    } else {
+        vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+
+        // the secondary command buffers continue the render pass of the primary
+        VkCommandBufferInheritanceInfo inheritanceInfo = {};
+        inheritanceInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+        inheritanceInfo.renderPass = m_renderPass;
+        inheritanceInfo.subpass = 0;
+        inheritanceInfo.framebuffer = m_swapChainFrameBuffers[imageIndex];
+
+        std::vector<VkCommandBuffer>& secondaryCommandBuffers = m_secondaryCommandBuffers[m_currentFrame];
+        m_recordingThreads.ParallelFor(taskCount, [&](uint32_t task) {
+            // contiguous ranges keep the draw order of the objects
+            uint32_t firstObject = objectCount * task / taskCount;
+            uint32_t lastObject = objectCount * (task + 1) / taskCount;
+            vkResetCommandPool(m_logicalDevice, m_secondaryCommandPools[m_currentFrame][task], 0);
+
+            VkCommandBufferBeginInfo secondaryBeginInfo = {};
+            secondaryBeginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+            secondaryBeginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT | VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+            secondaryBeginInfo.pInheritanceInfo = &inheritanceInfo;
+            if (vkBeginCommandBuffer(secondaryCommandBuffers[task], &secondaryBeginInfo) != VK_SUCCESS) {
+                throw std::runtime_error("Failed to begin recording secondary command buffer!");
+            }
+            RecordObjectDraws(secondaryCommandBuffers[task], firstObject, lastObject - firstObject);
+            if (vkEndCommandBuffer(secondaryCommandBuffers[task]) != VK_SUCCESS) {
+                throw std::runtime_error("Failed to record secondary command buffer!");
+            }
+        });
+        vkCmdExecuteCommands(commandBuffer, taskCount, secondaryCommandBuffers.data());
+    }
+
+    // end render pass
+    vkCmdEndRenderPass(commandBuffer);
+    m_gpuProfiler.CmdEndScope(commandBuffer, m_currentFrame, 0);
+
+    // end recording
+    if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to record command buffer!");
+    }
+}
+
+void BasicApplication::RecordObjectDraws(VkCommandBuffer commandBuffer, uint32_t firstObject, uint32_t objectCount) {
+    // viewport and scissor are dynamic states of the pipelines (and not inherited by secondary command buffers),
+    // a single view is set once, split views are set before each draw
+    bool singleView = m_views.size() == 1;
+    if (singleView) {
+        vkCmdSetViewport(commandBuffer, 0, 1, &m_views[0].viewport);
+        vkCmdSetScissor(commandBuffer, 0, 1, &m_views[0].scissor);
+    }
+
+    // the geometry of all the objects is in the buffers of the geometry pool
+    m_geometryPool.CmdBind(commandBuffer);
+
+    // objects sharing a pipeline (see the pipeline registry) don't bind it again
+    VkPipeline boundPipeline = VK_NULL_HANDLE;
+    // loop each object
+    for(uint32_t objectIndex = firstObject; objectIndex < firstObject + objectCount; objectIndex++)
+    {
+        BaseObject* object = m_objects[objectIndex];
+        m_gpuProfiler.CmdBeginScope(commandBuffer, m_currentFrame, objectIndex + 1);
+        // bind the graphics pipeline
+        if (object->m_graphicsPipeline->pipeline != boundPipeline) {
+            boundPipeline = object->m_graphicsPipeline->pipeline;
+            vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, boundPipeline);
         }
+        // bind the descriptor set to the descriptors in the shader with vkCmdBindDescriptorSets (before the vkCmdDrawIndexed),
+        // the dynamic offset selects the object's uniform data of this frame in the uniform ring
+        vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, object->m_pipelineLayout, 0, 1, &object->m_descriptorSet, 1, &object->m_uniformOffset);
+        // draw the object from its ranges of the geometry pool, into each view
+        const GeometryRange& geometry = object->m_geometry;
+        for (const RenderView& view : m_views) {
+            if (!singleView) {
+                vkCmdSetViewport(commandBuffer, 0, 1, &view.viewport);
+                vkCmdSetScissor(commandBuffer, 0, 1, &view.scissor);
+            }
+            vkCmdDrawIndexed(commandBuffer, geometry.indexCount, 1, geometry.firstIndex, static_cast<int32_t>(geometry.firstVertex), 0);
+        }
+        m_gpuProfiler.CmdEndScope(commandBuffer, m_currentFrame, objectIndex + 1);
     }
+
 }
 
-void BasicApplication::CreateSemaphores() {
+void BasicApplication::CreateSyncObjects() {
+    m_imageAvailableSemaphores.resize(m_framesInFlight);
+    m_renderFinishedSemaphores.resize(m_framesInFlight);
+    // value 0 is always completed, so the first wait of each frame and image returns immediately
+    m_frameTimelineValues.assign(m_framesInFlight, 0);
+    m_imagesInFlight.assign(m_swapChainImages.size(), 0);
+
     VkSemaphoreCreateInfo semaphoreInfo = {};
     semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
-    if (vkCreateSemaphore(m_logicalDevice, &semaphoreInfo, nullptr, &m_imageAvailableSemaphore) != VK_SUCCESS ||
-    vkCreateSemaphore(m_logicalDevice, &semaphoreInfo, nullptr, &m_renderFinishedSemaphore) != VK_SUCCESS) {
-        throw std::runtime_error("Failed to create semaphores!");
-    }
 
+    for (size_t i = 0; i < m_framesInFlight; i++) {
+        if (vkCreateSemaphore(m_logicalDevice, &semaphoreInfo, HostAllocator::GetCallbacks(), &m_imageAvailableSemaphores[i]) != VK_SUCCESS ||
+        vkCreateSemaphore(m_logicalDevice, &semaphoreInfo, HostAllocator::GetCallbacks(), &m_renderFinishedSemaphores[i]) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to create synchronization objects for a frame!");
+        }
+    }
+    m_graphicsTimeline.Create(m_logicalDevice, m_timelineSemaphoreEnabled);
 }
 
 void BasicApplication::DrawFrame() {
-    // acquire available image in the swap chain
+    m_frameProfiler.BeginFrame();
+    // advance the simulation in fixed steps up to the current time
+    {
+        ScopedFrameTimer timer(m_frameProfiler, FramePhase::Simulate);
+        UpdateSimulation();
+    }
+    // wait until the GPU has finished the frame that used the same semaphores before
+    {
+        ScopedFrameTimer timer(m_frameProfiler, FramePhase::Wait);
+        m_graphicsTimeline.Wait(m_logicalDevice, m_frameTimelineValues[m_currentFrame]);
+    }
+    // the last command buffer of this frame has finished, read its timestamps before recording it again
+    m_gpuProfiler.Resolve(m_logicalDevice, m_currentFrame);
+    // destroy the removed objects no finished frame uses anymore
+    m_deletionQueue.Collect(m_graphicsTimeline.GetCompletedValue(m_logicalDevice));
+
+    // acquire available image in the swap chain (headless images are used in turn)
     uint32_t imageIndex;
-    vkAcquireNextImageKHR(m_logicalDevice, m_swapChain, std::numeric_limits<uint64_t>::max(), m_imageAvailableSemaphore, VK_NULL_HANDLE, &imageIndex);
+    VkResult acquireResult = VK_SUCCESS;
+    {
+        ScopedFrameTimer timer(m_frameProfiler, FramePhase::Acquire);
+        if (m_headless) {
+            imageIndex = m_nextHeadlessImage;
+            m_nextHeadlessImage = (m_nextHeadlessImage + 1) % m_headlessImageCount;
+        } else {
+            acquireResult = vkAcquireNextImageKHR(m_logicalDevice, m_swapChain, std::numeric_limits<uint64_t>::max(), m_imageAvailableSemaphores[m_currentFrame], VK_NULL_HANDLE, &imageIndex);
+        }
+    }
+    // the swap chain no longer matches the surface, skip this frame (nothing has been submitted for it)
+    // VK_SUBOPTIMAL_KHR still acquires an image, the swap chain is recreated after presenting it
+    if (acquireResult == VK_ERROR_OUT_OF_DATE_KHR) {
+        RecreateSwapChain();
+        m_frameProfiler.EndFrame();
+        return;
+    } else if (acquireResult != VK_SUCCESS && acquireResult != VK_SUBOPTIMAL_KHR) {
+        throw std::runtime_error("Failed to acquire swap chain image!");
+    }
+
+    // an older frame may still be rendering to this image
+    if (!m_graphicsTimeline.IsCompleted(m_logicalDevice, m_imagesInFlight[imageIndex])) {
+        ScopedFrameTimer timer(m_frameProfiler, FramePhase::Wait);
+        m_graphicsTimeline.Wait(m_logicalDevice, m_imagesInFlight[imageIndex]);
+    }
+    // update the uniform ring region of this frame, while the GPU may still be rendering the previous frames
+    {
+        ScopedFrameTimer timer(m_frameProfiler, FramePhase::UpdateUniforms);
+        UpdateUniformBuffersForObjects();
+    }
 
-    // update the uniform buffer
-    UpdateUniformBuffersForObjects(imageIndex);
+    // uploads of the objects added since the last frame run before this frame on the graphics queue,
+    // or on the transfer queue while this frame is recorded
+    SubmitUploads(false);
+    // pipelines of the objects added since the last frame
+    m_pipelineRegistry.CompilePending(m_logicalDevice, m_recordingThreads);
+
+    // record the current object list into the command buffer of this frame
+    {
+        ScopedFrameTimer timer(m_frameProfiler, FramePhase::Record);
+        RecordCommandBuffer(imageIndex);
+    }
 
     // submit commands
     VkSubmitInfo submitInfo = {};
     submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-    VkSemaphore waitSemaphores[] = {m_imageAvailableSemaphore};
-    VkPipelineStageFlags waitStages[] = {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
-    submitInfo.waitSemaphoreCount = 1;
-    submitInfo.pWaitSemaphores = waitSemaphores;
-    submitInfo.pWaitDstStageMask = waitStages;
+    std::vector<VkSemaphore> waitSemaphores;
+    std::vector<VkPipelineStageFlags> waitStages;
+    std::vector<uint64_t> waitValues;
+    // headless images are not acquired or presented, the timeline alone keeps them in order
+    if (!m_headless) {
+        waitSemaphores.push_back(m_imageAvailableSemaphores[m_currentFrame]);
+        waitStages.push_back(VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT);
+        waitValues.push_back(0);
+    }
+    // the uploads acquired by this frame must have completed on the transfer queue
+    if (m_frameUploadWaitValue > 0) {
+        waitSemaphores.push_back(m_uploadContext.GetSemaphore());
+        waitStages.push_back(UPLOAD_CONSUMER_STAGES);
+        waitValues.push_back(m_frameUploadWaitValue);
+    }
+    submitInfo.waitSemaphoreCount = static_cast<uint32_t>(waitSemaphores.size());
+    submitInfo.pWaitSemaphores = waitSemaphores.data();
+    submitInfo.pWaitDstStageMask = waitStages.data();
     submitInfo.commandBufferCount = 1;
-    submitInfo.pCommandBuffers = &m_commandBuffers[imageIndex];
+    submitInfo.pCommandBuffers = &m_frameCommandBuffers[m_currentFrame];
 
-    VkSemaphore signalSemaphores[] = {m_renderFinishedSemaphore};
-    submitInfo.signalSemaphoreCount = 1;
+    VkSemaphore signalSemaphores[] = {m_renderFinishedSemaphores[m_currentFrame]};
+    submitInfo.signalSemaphoreCount = m_headless ? 0 : 1;
     submitInfo.pSignalSemaphores = signalSemaphores;
 
-    if (vkQueueSubmit(m_graphicsQueue, 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS) {
-        throw std::runtime_error("Failed to submit draw command buffer!");
+    // the submission signals the next timeline value when the command buffer finishes
+    {
+        ScopedFrameTimer timer(m_frameProfiler, FramePhase::Submit);
+        uint64_t timelineValue = m_graphicsTimeline.Submit(m_logicalDevice, m_graphicsQueue, submitInfo, waitValues.data());
+        // the frame and the image are in use until the value is reached
+        m_frameTimelineValues[m_currentFrame] = timelineValue;
+        m_imagesInFlight[imageIndex] = timelineValue;
     }
+    m_gpuProfiler.MarkSubmitted(m_currentFrame);
 
     // present
-    VkPresentInfoKHR presentInfo = {};
-    presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
-
-    presentInfo.waitSemaphoreCount = 1;
-    presentInfo.pWaitSemaphores = signalSemaphores;
-    VkSwapchainKHR swapChains[] = {m_swapChain};
-    presentInfo.swapchainCount = 1;
-    presentInfo.pSwapchains = swapChains;
-    presentInfo.pImageIndices = &imageIndex;
-    presentInfo.pResults = nullptr;
-    vkQueuePresentKHR(m_presentQueue, &presentInfo);
-
-    // if CPU is submitting commands faster than the GPU can keep ip with, then the queue will fill up
-    // also we are reusing the two semaphores
-    // so we should wait for the queue is idle and then draw next frame
-    vkQueueWaitIdle(m_presentQueue);
+    VkResult presentResult = VK_SUCCESS;
+    if (!m_headless) {
+        ScopedFrameTimer timer(m_frameProfiler, FramePhase::Present);
+        VkPresentInfoKHR presentInfo = {};
+        presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
+
+        presentInfo.waitSemaphoreCount = 1;
+        presentInfo.pWaitSemaphores = signalSemaphores;
+        VkSwapchainKHR swapChains[] = {m_swapChain};
+        presentInfo.swapchainCount = 1;
+        presentInfo.pSwapchains = swapChains;
+        presentInfo.pImageIndices = &imageIndex;
+        presentInfo.pResults = nullptr;
+        presentResult = vkQueuePresentKHR(m_presentQueue, &presentInfo);
+    }
+    if (presentResult == VK_ERROR_OUT_OF_DATE_KHR || presentResult == VK_SUBOPTIMAL_KHR || m_framebufferResized || m_presentModeChanged) {
+        RecreateSwapChain();
+    } else if (presentResult != VK_SUCCESS) {
+        throw std::runtime_error("Failed to present swap chain image!");
+    }
 
-    // TODO optimal way to use graphics pipeline for multiple frames at a time
+    // move to the next frame in flight, the CPU only blocks when it is m_framesInFlight frames ahead of the GPU
+    m_currentFrame = (m_currentFrame + 1) % m_framesInFlight;
+    m_frameProfiler.EndFrame();
 }
 
-void BasicApplication::UpdateUniformBuffersForObjects(uint32_t currentImage) {
-    // the time when app starting
-    static auto moveTime = std::chrono::high_resolution_clock::now();
-    auto currentTime = std::chrono::high_resolution_clock::now();
-    // get the duration between start time and current time (seconds)
-    float duration = std::chrono::duration<float, std::chrono::seconds::period>(currentTime - moveTime).count();
+void BasicApplication::UpdateSimulation() {
+    auto currentTime = std::chrono::steady_clock::now();
+    if (!m_simulationStarted) {
+        m_lastSimulationTime = currentTime;
+        m_simulationStarted = true;
+    }
+    m_simulationAccumulator += std::chrono::duration<double>(currentTime - m_lastSimulationTime).count();
+    m_lastSimulationTime = currentTime;
+
+    // run as many fixed steps as the elapsed time needs, so the simulation speed doesn't depend on the frame rate
+    uint32_t steps = 0;
+    while (m_simulationAccumulator >= m_simulationTimeStep) {
+        // after a long stall (e.g. dragging the window), drop the time instead of stepping for several frames
+        if (steps == m_maxSimulationStepsPerFrame) {
+            m_simulationAccumulator = std::fmod(m_simulationAccumulator, m_simulationTimeStep);
+            break;
+        }
+        for (BaseObject* object : m_objects)
+        {
+            object->Update(static_cast<float>(m_simulationTimeStep));
+        }
+        m_simulationAccumulator -= m_simulationTimeStep;
+        steps++;
+    }
+}
 
+void BasicApplication::UpdateUniformBuffersForObjects() {
+    // how far the rendered frame is between the last two simulation steps
+    float alpha = static_cast<float>(m_simulationAccumulator / m_simulationTimeStep);
+
+    // the last submission of this frame has completed, so its region can be overwritten
+    m_uniformRing.BeginFrame(m_currentFrame);
     for (BaseObject* object : m_objects)
     {
-        object->UpdateUniformBuffer(m_logicalDevice, duration, currentImage);
+        object->UpdateUniformBuffer(m_uniformRing, alpha);
     }
 }
 
+void BasicApplication::SubmitUploads(bool wait) {
+    if (m_uploadContext.HasRecordedCommands()) {
+        // the staging space of the batch is tagged with its value
+        m_stagingArena.EndBatch(m_uploadContext.Submit(m_logicalDevice));
+    }
+    if (wait) {
+        m_uploadContext.Flush(m_logicalDevice);
+    }
+    // the staging space of the batches the GPU has finished can be reused, without waiting for the others
+    m_stagingArena.Recycle(m_logicalDevice, m_memoryAllocator, m_uploadContext.GetCompletedValue(m_logicalDevice));
+}
+
+void BasicApplication::ReserveUniformRing(size_t objectCount) {
+    VkDeviceSize bytesPerFrame = objectCount * m_uniformRing.AlignSize(sizeof(UniformBufferObject));
+    if (bytesPerFrame <= m_uniformRing.GetBytesPerFrame()) {return;}
+    VkBuffer oldBuffer = VK_NULL_HANDLE;
+    MemoryAllocation oldMemory;
+    m_uniformRing.Reserve(m_logicalDevice, m_memoryAllocator, bytesPerFrame, oldBuffer, oldMemory);
+    // the next frames bind new descriptor sets of the new buffer, the frames submitted so far may still read the
+    // old buffer through the old sets, which live until they have finished (without waiting)
+    std::vector<VkDescriptorPool> oldDescriptorPools;
+    for (BaseObject* object : m_objects) {
+        oldDescriptorPools.push_back(object->RecreateDescriptorSet(m_logicalDevice, m_pipelineRegistry.GetDescriptorSetLayout(), m_uniformRing));
+    }
+    m_deletionQueue.Push(m_graphicsTimeline.GetLastSubmittedValue(), [this, oldBuffer, oldMemory, oldDescriptorPools]() mutable {
+        for (VkDescriptorPool descriptorPool : oldDescriptorPools) {
+            vkDestroyDescriptorPool(m_logicalDevice, descriptorPool, HostAllocator::GetCallbacks());
+        }
+        VulkanHelperFunctions::DestroyBuffer(m_logicalDevice, m_memoryAllocator, oldBuffer, oldMemory);
+    });
+}
+
 
+void BasicApplication::ReserveGeometryPool(uint32_t vertexCount, uint32_t indexCount) {
+    RetiredGeometryBuffers retiredBuffers;
+    if (!m_geometryPool.Reserve(m_logicalDevice, m_memoryAllocator, m_uploadContext, vertexCount, indexCount, retiredBuffers)) {return;}
+    // the frames submitted so far may still draw from the old buffers, and the upload batch may copy from them.
+    // The next frame waits for that batch (or follows it on the graphics queue), so the old buffers live until it has finished
+    m_deletionQueue.Push(m_graphicsTimeline.GetLastSubmittedValue() + 1, [this, retiredBuffers]() mutable {
+        VulkanHelperFunctions::DestroyBuffer(m_logicalDevice, m_memoryAllocator, retiredBuffers.vertexBuffer, retiredBuffers.vertexMemory);
+        VulkanHelperFunctions::DestroyBuffer(m_logicalDevice, m_memoryAllocator, retiredBuffers.indexBuffer, retiredBuffers.indexMemory);
+    });
+}
 
 void BasicApplication::CreateTexture(const char *textureFile) {
     BaseTexture* texture = new BaseTexture(textureFile);
-    texture->CreateTexture(m_logicalDevice, m_physicalDevice, m_commandPool, m_graphicsQueue);
+    texture->CreateTexture(m_logicalDevice, m_physicalDevice, m_memoryAllocator, m_stagingArena, m_uploadContext);
     m_textures[textureFile] = texture;
-    // make ensure creating object after creating textures
-    vkDeviceWaitIdle(m_logicalDevice);
 }
 
 void BasicApplication::DestroyTextures() {
     for (auto texture : m_textures)
     {
-        texture.second->DestroyTexture(m_logicalDevice);
+        texture.second->DestroyTexture(m_logicalDevice, m_memoryAllocator);
         delete texture.second;
         texture.second = nullptr;
     }
 }
 
-void BasicApplication::AddObjectToApplication(const char *objectName, ObjectType objectType, const char *objectFile,
+BaseObject* BasicApplication::AddObjectToApplication(const char *objectName, ObjectType objectType, const char *objectFile,
                                               const char *objectTexture) {
+    // the uniform ring holds the uniform data of every object in each frame
+    ReserveUniformRing(m_objects.size() + 1);
     BaseObject* newObject = new BaseObject(objectType, objectFile);
+    newObject->SetName(objectName ? objectName : "UNKNOWN NAME");
     m_objects.push_back(newObject);
+    // the timestamp scopes follow the object list
+    m_gpuScopeNames.clear();
     // create texture first, because descriptor creation requires texture sampler when creating objects
     if (objectTexture)
     {
@@ -818,20 +1540,40 @@ void BasicApplication::AddObjectToApplication(const char *objectName, ObjectType
     }
 
     // create object
-    newObject->CreateObject(m_logicalDevice, m_physicalDevice, m_commandPool, m_graphicsQueue, static_cast<uint32_t>(m_swapChainImages.size()), m_renderPass, m_swapChainExtent);
+    ReserveGeometryPool(newObject->GetVertexCount(), newObject->GetIndexCount());
+    newObject->CreateObject(m_logicalDevice, m_memoryAllocator, m_stagingArena, m_uploadContext, m_geometryPool, m_uniformRing, m_pipelineRegistry, m_renderPass, GetViewExtent());
+    // the uploads are batched with the ones of the next objects, and submitted before the next frame
+    if (m_stagingArena.GetUsedBytes() > MAX_PENDING_UPLOAD_BYTES) {
+        SubmitUploads(true);
+    }
 
     if (objectName)
     {
         std::cout <<"Create object: " << objectName << " successfully" << std::endl;
     }
     else{std::cout <<"Create object: UNKNOWN NAME successfully" << std::endl;}
+    return newObject;
+}
 
+void BasicApplication::RemoveObjectFromApplication(BaseObject *object) {
+    auto it = std::find(m_objects.begin(), m_objects.end(), object);
+    if (it == m_objects.end()) {
+        throw std::runtime_error("Failed to remove an object that is not in the application!");
+    }
+    // the next frames don't draw it, the timestamp scopes are rebuilt for the remaining objects
+    m_objects.erase(it);
+    m_gpuScopeNames.clear();
+    // the frames submitted so far may still draw it, its pipeline, descriptors and geometry ranges live until they have finished
+    m_deletionQueue.Push(m_graphicsTimeline.GetLastSubmittedValue(), [this, object]() {
+        object->DestroyObject(m_logicalDevice, m_geometryPool, m_pipelineRegistry);
+        delete object;
+    });
 }
 
 void BasicApplication::DestroyObjects() {
     for (BaseObject* object : m_objects)
     {
-        object->DestroyObject(m_logicalDevice);
+        object->DestroyObject(m_logicalDevice, m_geometryPool, m_pipelineRegistry);
         delete object;
         object = nullptr;
     }
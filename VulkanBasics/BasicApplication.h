@@ -8,15 +8,31 @@
 #include <GLFW/glfw3.h>
 #include <stdexcept>
 #include <cstdint>
+#include <chrono>
+#include <functional>
 #include <vector>
 #include <set>
 #include <map>
 #include <unordered_map>
 #include "BaseObject.h"
+#include "FrameProfiler.h"
+#include "GpuProfiler.h"
+#include "FramePacer.h"
+#include "GpuTimeline.h"
+#include "ThreadPool.h"
+#include "DeviceMemoryAllocator.h"
+#include "UniformRing.h"
+#include "StagingArena.h"
+#include "UploadContext.h"
+#include "DeferredDeletionQueue.h"
+#include "HostAllocator.h"
+#include "PipelineCache.h"
 
 struct QueueFamilyIndices{
     std::optional<uint32_t> queueFamilyIndexForDrawing;
     std::optional<uint32_t> queueFamilyIndexForPresenting;
+    // transfer-only queue family for uploads (optional)
+    std::optional<uint32_t> queueFamilyIndexForTransfer;
 
     // check if this queueFamily can be used
     bool IsComplete() const {
@@ -34,29 +50,102 @@ struct SwapChainSupportDetails {
     std::vector<VkPresentModeKHR> presentModes;
 };
 
+// settings chosen when initializing the application
+struct ApplicationSettings {
+    // number of frames the CPU may prepare while the GPU is still rendering previous ones (1 = no CPU/GPU overlap)
+    uint32_t framesInFlight = 2;
+    // render without window, surface and swap chain into images owned by the application (no presentation)
+    bool headless = false;
+    // number of images in the headless render target ring
+    uint32_t headlessImageCount = 3;
+    // record the CPU time of each frame phase (cheap enough to stay on in release builds)
+    bool enableFrameProfiler = true;
+    // file name (without extension) the frame timings are exported to as .csv and .json at clean up, nullptr to skip
+    const char* frameTimingsFile = nullptr;
+    // measure the GPU time of the render pass and of each object draw with timestamp queries
+    bool enableGpuProfiler = true;
+    // present mode and frame limiter (the present mode is ignored in headless mode)
+    PresentPolicy presentPolicy = PresentPolicy::LowLatency;
+    // frame rate of PresentPolicy::TargetFps
+    double targetFps = 60.0;
+    // synchronize the frames with a timeline semaphore if the device supports Vulkan 1.2, otherwise with fences
+    bool preferTimelineSemaphore = true;
+    // upload on a dedicated transfer queue if the device has one (needs the timeline semaphore), otherwise on the graphics queue
+    bool preferTransferQueue = true;
+    // worker threads recording secondary command buffers besides the render thread, -1 = one less than the hardware threads.
+    // They also compile the pipelines of new objects, so 0 compiles them one by one on the render thread
+    int recordingThreadCount = -1;
+    // scenes with fewer objects for each thread are recorded with fewer threads (or on the render thread only)
+    uint32_t minObjectsPerRecordingThread = 256;
+    // file the pipeline cache is loaded from at start up and saved to at clean up (relative to the working directory,
+    // written on every run), nullptr to compile every pipeline each run
+    const char* pipelineCacheFile = "pipeline_cache.bin";
+    // pass VkAllocationCallbacks counting the host allocations of the driver by scope (reported at clean up)
+    bool trackHostAllocations = false;
+    // print the statistics of the memory, uploads, pipelines and objects at start up and clean up
+    bool printStatistics = false;
+    // steps per second of the fixed time step simulation, independent of the frame rate
+    double simulationRate = 60.0;
+    // the simulation falls behind instead of catching up when a frame needs more steps than this
+    uint32_t maxSimulationStepsPerFrame = 8;
+    // split the render target into side by side views (split screen), each drawing all the objects
+    uint32_t viewCount = 1;
+};
+
+// region of the render target a view is drawn to, set as dynamic state so the pipelines don't depend on it
+struct RenderView {
+    VkViewport viewport;
+    VkRect2D scissor;
+};
+
 
 class BasicApplication {
 
 public:
     // initial window, device, swap chain, render pass and command pool
-    void InitialApplication(int windowWidth, int windowHeight, const char* windowName);
+    void InitialApplication(int windowWidth, int windowHeight, const char* windowName, const ApplicationSettings& settings = ApplicationSettings());
 
-    void AddObjectToApplication(const char *objectName, ObjectType objectType, const char *objectFile,
+    // returns the object, which can be given to RemoveObjectFromApplication
+    BaseObject* AddObjectToApplication(const char *objectName, ObjectType objectType, const char *objectFile,
                                 const char *objectTexture);
-
-    void RunApplication();
+    // stop drawing the object, its resources are destroyed once the frames in flight have finished (without waiting)
+    void RemoveObjectFromApplication(BaseObject* object);
+    // called before each frame is drawn with the number of frames drawn so far, e.g. to add and remove objects while running
+    inline void SetFrameCallback(const std::function<void(uint64_t)>& callback) {m_frameCallback = callback;}
+
+    // run until the window is closed, or until frameCount frames are drawn if frameCount is not 0
+    void RunApplication(uint32_t frameCount = 0);
+    // frame throughput of the last run, including the frames in flight when it ended (0 if no frame was drawn)
+    inline double GetFramesPerSecond() const {return m_framesPerSecond;}
+    // from InitialApplication to the first frame of the last run, including the pipelines compiled before it (milliseconds)
+    inline double GetStartupTime() const {return m_startupTime;}
+
+    // CPU frame timings of the recent frames, can be requested while the application is running (also by pressing T)
+    FrameTimingReport GetFrameTimingReport() const;
+    void PrintFrameTimings() const;
+
+    // GPU time of the render pass and of each object, keyed by the object name
+    std::vector<GpuScopeTiming> GetGpuTimings() const;
+    void PrintGpuTimings() const;
+
+    // change the present policy while running (also by pressing P), the swap chain is recreated before the next frame
+    void SetPresentPolicy(PresentPolicy policy, double targetFps = 60.0);
+    inline PresentPolicy GetPresentPolicy() const {return m_presentPolicy;}
+    // frame-to-frame intervals and jitter of the recent frames
+    FramePacingReport GetFramePacingReport() const;
+    void PrintFramePacing() const;
 
     // private functions
 private:
     void InitWindow(int windowWidth, int windowHeight, const char* windowName);
     void InitVulkan();
     void CreateVulkanInstance();
-    void MainLoop();
+    void MainLoop(uint32_t frameCount);
     void CleanUp();
 
     // Get the names of extension that vulkan supports
     const std::vector<const char*> GetVulkanSupportedExtensionNames();
-    // Get the names of glfw required extensions
+    // Get the names of glfw required extensions (only the debug extension in headless mode)
     const std::vector<const char*> GetGlfwRequiredExtensionNames();
     // Querying details of swap chain support
     SwapChainSupportDetails GetSwapChainSupportDetails(const VkPhysicalDevice& device);
@@ -70,6 +159,11 @@ private:
     // check if required device extensions are supported
     bool CheckDeviceExtensions(VkPhysicalDevice const &device);
 
+    // keyboard input of the window
+    static void KeyCallBack(GLFWwindow* window, int key, int scancode, int action, int mods);
+    // the framebuffer of the window has been resized
+    static void FramebufferResizeCallBack(GLFWwindow* window, int width, int height);
+
     static VKAPI_ATTR VkBool32 VKAPI_CALL DebugCallBack(VkDebugUtilsMessageSeverityFlagBitsEXT messageSeverity,
                                                  VkDebugUtilsMessageTypeFlagsEXT messageType,
                                                  const VkDebugUtilsMessengerCallbackDataEXT *pCallbackData,
@@ -88,7 +182,9 @@ private:
     /* Select settings for the swap chain*/
     // surface format
     VkSurfaceFormatKHR PickSwapSurfaceFormat(const std::vector<VkSurfaceFormatKHR>& availableFormats);
-    // present mode
+    // present modes the policy prefers, in order, FIFO (always supported) when none of them is available
+    static std::vector<VkPresentModeKHR> GetPreferredPresentModes(PresentPolicy policy);
+    // present mode of the present policy
     VkPresentModeKHR PickSwapPresentMode(const std::vector<VkPresentModeKHR>& availablePresentModes);
     // image resolutions from surface capabilities
     VkExtent2D PickSwapExtent(const VkSurfaceCapabilitiesKHR& capabilities);
@@ -104,8 +200,15 @@ private:
     // create logical device
     void CreateLogicalDevice();
 
-    // create the swap chain
-    void CreateSwapChain();
+    // create the swap chain (oldSwapChain is the one being replaced when recreating)
+    void CreateSwapChain(VkSwapchainKHR oldSwapChain = VK_NULL_HANDLE);
+    // recreate the swap chain after resizing, only the resources depending on the swap chain images are rebuilt
+    void RecreateSwapChain();
+    // destroy the frame buffers and image views of the swap chain
+    void CleanupSwapChain();
+
+    // create the images rendered to in headless mode, instead of the swap chain
+    void CreateHeadlessImages();
 
     // create the image views for frame in swap chain
     void CreateImageViewsForSwapChain();
@@ -116,14 +219,24 @@ private:
     // Create frame buffers
     void CreateFrameBuffers();
 
-    // Create command pool
-    void CreateCommandPool();
-
-    // create command buffers
-    void CreateCommandBuffers();
-
-    // Create semaphores
-    void CreateSemaphores();
+    // split the extent of the render target into the views
+    void UpdateViews();
+    // extent of the first view, the projection of the objects
+    inline VkExtent2D GetViewExtent() const {return m_views.front().scissor.extent;}
+
+    // create a resettable command pool and a primary command buffer for each frame in flight
+    void CreateFrameCommandPools();
+    void DestroyFrameCommandPools();
+    // record the draw commands of all the objects into the command buffer of the current frame,
+    // large scenes are split into secondary command buffers recorded by the worker threads
+    void RecordCommandBuffer(uint32_t imageIndex);
+    // set the viewport and scissor, then draw the objects [firstObject, firstObject + objectCount)
+    void RecordObjectDraws(VkCommandBuffer commandBuffer, uint32_t firstObject, uint32_t objectCount);
+    // recreate the timestamp query pool if there are more scopes (objects) than it can hold
+    void UpdateGpuProfilerCapacity(uint32_t scopeCount);
+
+    // Create the semaphores for each frame in flight and the timeline of the graphics queue
+    void CreateSyncObjects();
 
     // draw frame, run in main loop
     void DrawFrame();
@@ -132,8 +245,16 @@ private:
     void CreateObjects();
     // destroy objects
     void DestroyObjects();
-    // update uniform buffers for objects
-    void UpdateUniformBuffersForObjects(uint32_t currentImage);
+    // step the simulation of the objects with the fixed time step until it reaches the current time
+    void UpdateSimulation();
+    // update uniform buffers for objects, interpolated between the last two simulation steps
+    void UpdateUniformBuffersForObjects();
+    // submit the uploads recorded since the last call (and wait for them), reuse the staging arena when they have completed
+    void SubmitUploads(bool wait);
+    // grow the uniform ring to hold the uniform data of objectCount objects
+    void ReserveUniformRing(size_t objectCount);
+    // grow the geometry pool to fit a mesh, uploading the geometry of the existing objects again if it is recreated
+    void ReserveGeometryPool(uint32_t vertexCount, uint32_t indexCount);
 
     void CreateTexture(const char *textureFile);
 
@@ -146,6 +267,8 @@ private:
     GLFWwindow* m_window = nullptr;
     // vulkan instance (specify the details about your applications to the driver)
     VkInstance m_Instance;
+    // the highest version supported by the loader, up to 1.2
+    uint32_t m_instanceApiVersion = VK_API_VERSION_1_0;
 
     // Window width and height
     uint32_t m_windowWidth;
@@ -162,8 +285,8 @@ private:
     //VK_LAYER_KHRONOS_validation: a layer containing all useful standard layers
     const std::vector<const char*> m_validationLayers = {"VK_LAYER_KHRONOS_validation"};
 
-    // Required physical device extensions
-    const std::vector<const char*> m_deviceExtensions = {VK_KHR_SWAPCHAIN_EXTENSION_NAME};
+    // Required physical device extensions (headless mode doesn't need the swap chain)
+    std::vector<const char*> m_deviceExtensions = {VK_KHR_SWAPCHAIN_EXTENSION_NAME};
 
     // debug messenger
     VkDebugUtilsMessengerEXT m_debugMessenger;
@@ -177,12 +300,51 @@ private:
     VkQueue m_graphicsQueue;
     // present queue for presentation
     VkQueue m_presentQueue;
+    // transfer queue for uploads, only retrieved if m_transferQueueEnabled
+    VkQueue m_transferQueue = VK_NULL_HANDLE;
+    bool m_preferTransferQueue = true;
+    bool m_transferQueueEnabled = false;
+
+    // host allocations of the driver, active if m_trackHostAllocations
+    HostAllocator m_hostAllocator;
+    bool m_trackHostAllocations = false;
+    bool m_printStatistics = false;
+    // sub-allocates the memory of all the buffers and images
+    DeviceMemoryAllocator m_memoryAllocator;
+    // uniform data of all the objects, written every frame at dynamic offsets
+    UniformRing m_uniformRing;
+    // reused staging memory of the vertex, index and texture uploads
+    StagingArena m_stagingArena;
+    // vertices and indices of all the objects, bound once per command buffer
+    GeometryPool m_geometryPool;
+    // pipelines of all the objects are created with it, persisted in m_pipelineCacheFile
+    PipelineCache m_pipelineCache;
+    const char* m_pipelineCacheFile = nullptr;
+    // shader modules of the pipelines, each SPIR-V file is loaded once
+    ShaderLibrary m_shaderLibrary;
+    // objects with the same shaders and state share one pipeline
+    PipelineRegistry m_pipelineRegistry;
+    // InitialApplication was called, the start up time is reported when the first frame is drawn
+    std::chrono::high_resolution_clock::time_point m_startupBeginTime;
+    double m_startupTime = 0.0;
+    double m_framesPerSecond = 0.0;
 
     // Window surface
-    VkSurfaceKHR m_windowSurface;
+    VkSurfaceKHR m_windowSurface = VK_NULL_HANDLE;
+
+    // headless mode renders into m_swapChainImages backed by these memories, and never presents
+    bool m_headless = false;
+    uint32_t m_headlessImageCount = 3;
+    std::vector<MemoryAllocation> m_headlessImagesMemory;
+    // next image of the headless ring to render to
+    uint32_t m_nextHeadlessImage = 0;
 
     // swap chain
-    VkSwapchainKHR m_swapChain;
+    VkSwapchainKHR m_swapChain = VK_NULL_HANDLE;
+    // set by the resize callback, the swap chain is recreated after presenting
+    bool m_framebufferResized = false;
+    // the present policy has changed, the swap chain is recreated after presenting
+    bool m_presentModeChanged = false;
     std::vector<VkImage> m_swapChainImages;
     VkFormat m_swapChainImageFormat;
     VkExtent2D m_swapChainExtent;
@@ -196,20 +358,76 @@ private:
     // frame buffers
     std::vector<VkFramebuffer> m_swapChainFrameBuffers;
 
-    // command pool to store the command buffers
-    VkCommandPool m_commandPool;
-    // don't need to destroy because these can be freed when command pool is destroyed
-    // each command buffers for each frame buffer
-    std::vector<VkCommandBuffer> m_commandBuffers;
+    // views of the render target, updated when its extent changes
+    uint32_t m_viewCount = 1;
+    std::vector<RenderView> m_views;
 
-    // semaphores (used in drawing frame)
-    VkSemaphore m_imageAvailableSemaphore;
-    VkSemaphore m_renderFinishedSemaphore;
+    // batches the upload commands of the objects and textures
+    UploadContext m_uploadContext;
+    // one command pool for each frame in flight, reset as a whole before the frame is recorded again
+    std::vector<VkCommandPool> m_frameCommandPools;
+    // don't need to destroy because these can be freed when command pool is destroyed
+    // the primary command buffer of each frame in flight, re-recorded every frame
+    std::vector<VkCommandBuffer> m_frameCommandBuffers;
+    // one command pool and secondary command buffer for each recording task of each frame in flight,
+    // a pool is only used by the thread running its task, so no locking is needed
+    std::vector<std::vector<VkCommandPool>> m_secondaryCommandPools;
+    std::vector<std::vector<VkCommandBuffer>> m_secondaryCommandBuffers;
+
+    // threads recording the secondary command buffers
+    ThreadPool m_recordingThreads;
+    uint32_t m_minObjectsPerRecordingThread = 256;
+
+    // number of frames that can be processed concurrently
+    uint32_t m_framesInFlight = 2;
+    // index of the frame in flight being prepared
+    uint32_t m_currentFrame = 0;
+
+    // semaphores (used in drawing frame), one pair for each frame in flight
+    std::vector<VkSemaphore> m_imageAvailableSemaphores;
+    std::vector<VkSemaphore> m_renderFinishedSemaphores;
+    // progress of the graphics queue, every frame submission signals the next value
+    GpuTimeline m_graphicsTimeline;
+    bool m_preferTimelineSemaphore = true;
+    // enabled on the logical device
+    bool m_timelineSemaphoreEnabled = false;
+    // VK_EXT_memory_budget enabled on the logical device, the allocator reports the heap budgets
+    bool m_memoryBudgetEnabled = false;
+    // value of the upload timeline the submission of the recorded frame waits for, 0 = none
+    uint64_t m_frameUploadWaitValue = 0;
+    // timeline value of the last submission of each frame in flight (0 = never submitted)
+    std::vector<uint64_t> m_frameTimelineValues;
+    // timeline value of the last frame that used each swap chain image (and its uniform buffers)
+    std::vector<uint64_t> m_imagesInFlight;
+
+    // CPU timings of the frame phases
+    FrameProfiler m_frameProfiler;
+    const char* m_frameTimingsFile = nullptr;
+
+    // GPU timings of the render pass and the objects, one query region for each frame in flight
+    GpuProfiler m_gpuProfiler;
+    bool m_enableGpuProfiler = true;
+    // names of the timestamp scopes of the current object list
+    std::vector<std::string> m_gpuScopeNames;
+
+    // fixed time step simulation (seconds), the accumulator holds the time not simulated yet
+    double m_simulationTimeStep = 1.0 / 60.0;
+    uint32_t m_maxSimulationStepsPerFrame = 8;
+    double m_simulationAccumulator = 0.0;
+    std::chrono::steady_clock::time_point m_lastSimulationTime;
+    bool m_simulationStarted = false;
 
     // objects in the scene
     std::vector<BaseObject*> m_objects;
+    // resources of the removed objects, destroyed when the graphics timeline has passed their last frame
+    DeferredDeletionQueue m_deletionQueue;
+    std::function<void(uint64_t)> m_frameCallback;
     std::unordered_map<const char*, BaseTexture*> m_textures;
 
+
+    // present mode and frame limiter
+    PresentPolicy m_presentPolicy = PresentPolicy::LowLatency;
+    FramePacer m_framePacer;
 };
 
 
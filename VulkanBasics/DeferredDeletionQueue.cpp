@@ -0,0 +1,24 @@
+#include "DeferredDeletionQueue.h"
+
+void DeferredDeletionQueue::Push(uint64_t value, std::function<void()> deleter) {
+    m_pendingDeleters.emplace_back(value, std::move(deleter));
+}
+
+size_t DeferredDeletionQueue::Collect(uint64_t completedValue) {
+    size_t count = 0;
+    while (!m_pendingDeleters.empty() && m_pendingDeleters.front().first <= completedValue) {
+        // popped first, a deleter may push again
+        std::function<void()> deleter = std::move(m_pendingDeleters.front().second);
+        m_pendingDeleters.pop_front();
+        deleter();
+        count++;
+    }
+    m_deletedCount += count;
+    return count;
+}
+
+void DeferredDeletionQueue::Flush() {
+    while (!m_pendingDeleters.empty()) {
+        Collect(m_pendingDeleters.back().first);
+    }
+}
@@ -0,0 +1,31 @@
+#ifndef VULKANBASICS_DEFERREDDELETIONQUEUE_H
+#define VULKANBASICS_DEFERREDDELETIONQUEUE_H
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <utility>
+
+// Destruction of GPU resources deferred until the submissions that may still use them have finished.
+// A deleter is queued with the timeline value of the last submission that may reference the resources and runs
+// once the GPU has reached that value, so removing resources while rendering never waits for the device.
+class DeferredDeletionQueue {
+public:
+    // run deleter once value has completed, a value smaller than one pushed before also waits for that one
+    void Push(uint64_t value, std::function<void()> deleter);
+    // run the deleters of the values up to completedValue, returns how many ran
+    size_t Collect(uint64_t completedValue);
+    // run all the deleters, the device must be idle
+    void Flush();
+
+    inline size_t GetPendingCount() const {return m_pendingDeleters.size();}
+    // deleters run since the queue was created
+    inline uint64_t GetDeletedCount() const {return m_deletedCount;}
+
+private:
+    // (value, deleter) in push order
+    std::deque<std::pair<uint64_t, std::function<void()>>> m_pendingDeleters;
+    uint64_t m_deletedCount = 0;
+};
+
+
+#endif //VULKANBASICS_DEFERREDDELETIONQUEUE_H
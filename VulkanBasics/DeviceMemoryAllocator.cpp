@@ -0,0 +1,346 @@
+#include "DeviceMemoryAllocator.h"
+#include "HostAllocator.h"
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <cstring>
+#include <stdexcept>
+
+#define DEFAULT_MEMORY_BLOCK_SIZE (64ull * 1024 * 1024)
+// a direct upload buffer takes at most this fraction of a host visible device local heap that is not all the memory
+#define DIRECT_UPLOAD_HEAP_FRACTION 4
+
+struct MemoryBlock {
+    VkDeviceMemory memory = VK_NULL_HANDLE;
+    void* mappedData = nullptr;
+    uint32_t memoryTypeIndex = 0;
+    bool linear = true;
+    RangeAllocator ranges;
+    uint64_t allocationCount = 0;
+};
+
+DeviceMemoryAllocator::DeviceMemoryAllocator() = default;
+
+DeviceMemoryAllocator::~DeviceMemoryAllocator() = default;
+
+bool DeviceMemoryAllocator::IsMemoryBudgetSupported(VkPhysicalDevice &physicalDevice, uint32_t instanceApiVersion) {
+    if (instanceApiVersion < VK_API_VERSION_1_1) {
+        return false;
+    }
+    uint32_t extensionCount = 0;
+    vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, nullptr);
+    std::vector<VkExtensionProperties> extensions(extensionCount);
+    vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, extensions.data());
+    return std::any_of(extensions.begin(), extensions.end(), [](const VkExtensionProperties& extension) {
+        return strcmp(extension.extensionName, VK_EXT_MEMORY_BUDGET_EXTENSION_NAME) == 0;
+    });
+}
+
+const char *DeviceMemoryAllocator::GetCategoryName(MemoryCategory category) {
+    switch (category) {
+        case MemoryCategory::Vertex: return "vertex";
+        case MemoryCategory::Index: return "index";
+        case MemoryCategory::Uniform: return "uniform";
+        case MemoryCategory::Texture: return "texture";
+        case MemoryCategory::Staging: return "staging";
+        case MemoryCategory::Swapchain: return "swapchain";
+        case MemoryCategory::Count: break;
+    }
+    return "unknown";
+}
+
+void DeviceMemoryAllocator::Create(VkInstance &instance, VkPhysicalDevice &physicalDevice, bool useMemoryBudget, VkDeviceSize blockSize) {
+    m_physicalDevice = physicalDevice;
+    // queried once, FindMemoryType and the heap classification use the cached properties
+    vkGetPhysicalDeviceMemoryProperties(physicalDevice, &m_memoryProperties);
+    ClassifyHeaps();
+    // loaded at runtime, so that the application still links against a 1.0 loader
+    m_getMemoryProperties2 = nullptr;
+    if (useMemoryBudget) {
+        m_getMemoryProperties2 = (PFN_vkGetPhysicalDeviceMemoryProperties2) vkGetInstanceProcAddr(instance, "vkGetPhysicalDeviceMemoryProperties2");
+    }
+    VkPhysicalDeviceProperties properties{};
+    vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+    m_bufferImageGranularity = std::max<VkDeviceSize>(properties.limits.bufferImageGranularity, 1);
+    m_blockSize = blockSize > 0 ? blockSize : DEFAULT_MEMORY_BLOCK_SIZE;
+    m_blocks.clear();
+    m_blocks.resize(m_memoryProperties.memoryTypeCount);
+    m_allocationCount = 0;
+    m_dedicatedAllocationCount = 0;
+    m_dedicatedBytes = 0;
+    m_heapReservedBytes.assign(m_memoryProperties.memoryHeapCount, 0);
+    m_reservedBytes = 0;
+    m_peakReservedBytes = 0;
+    m_categories.fill(MemoryCategoryStatistics());
+}
+
+void DeviceMemoryAllocator::Destroy(VkDevice &device) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_allocationCount > 0) {
+        std::cerr << m_allocationCount << " device memory allocations were not freed:" << std::endl;
+        for (size_t i = 0; i < m_categories.size(); i++) {
+            if (m_categories[i].allocationCount == 0) {continue;}
+            std::cerr << "  " << GetCategoryName(static_cast<MemoryCategory>(i)) << ": " << m_categories[i].allocationCount
+                      << " allocations, " << m_categories[i].bytes << " bytes" << std::endl;
+        }
+    }
+    // the leaked dedicated allocations are lost, the blocks are freed with everything in them
+    for (auto& blocks : m_blocks) {
+        for (auto& block : blocks) {
+            FreeDeviceMemory(device, block->memoryTypeIndex, block->ranges.GetSize(), block->memory);
+        }
+        blocks.clear();
+    }
+}
+
+uint32_t DeviceMemoryAllocator::FindMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) const {
+    for (uint32_t i = 0; i < m_memoryProperties.memoryTypeCount; i++) {
+        if ((typeFilter & (1 << i)) && (m_memoryProperties.memoryTypes[i].propertyFlags & properties) == properties) {
+            return i;
+        }
+    }
+    throw std::runtime_error("Failed to find suitable memory type!");
+}
+
+void DeviceMemoryAllocator::ClassifyHeaps() {
+    m_heapClassification = MemoryHeapClassification();
+    m_heapClassification.unifiedMemory = m_memoryProperties.memoryHeapCount > 0;
+    for (uint32_t i = 0; i < m_memoryProperties.memoryHeapCount; i++) {
+        if (!(m_memoryProperties.memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT)) {
+            m_heapClassification.unifiedMemory = false;
+        }
+    }
+    const VkMemoryPropertyFlags directFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+    for (uint32_t i = 0; i < m_memoryProperties.memoryTypeCount; i++) {
+        if ((m_memoryProperties.memoryTypes[i].propertyFlags & directFlags) == directFlags) {
+            m_heapClassification.hostVisibleDeviceLocalType = i;
+            m_heapClassification.hostVisibleDeviceLocalHeapSize = m_memoryProperties.memoryHeaps[m_memoryProperties.memoryTypes[i].heapIndex].size;
+            break;
+        }
+    }
+}
+
+bool DeviceMemoryAllocator::SupportsDirectUpload(VkDeviceSize size) const {
+    return m_heapClassification.hostVisibleDeviceLocalType != UINT32_MAX && size <= GetMaxDirectUploadSize();
+}
+
+VkDeviceSize DeviceMemoryAllocator::GetMaxDirectUploadSize() const {
+    if (m_heapClassification.hostVisibleDeviceLocalType == UINT32_MAX) {return 0;}
+    // with unified memory the heap is the memory of the whole system
+    if (m_heapClassification.unifiedMemory) {return m_heapClassification.hostVisibleDeviceLocalHeapSize;}
+    return m_heapClassification.hostVisibleDeviceLocalHeapSize / DIRECT_UPLOAD_HEAP_FRACTION;
+}
+
+MemoryAllocation DeviceMemoryAllocator::Allocate(VkDevice &device, const VkMemoryRequirements &requirements,
+                                                 VkMemoryPropertyFlags properties, bool linear, MemoryCategory category) {
+    MemoryAllocation allocation;
+    allocation.memoryTypeIndex = FindMemoryType(requirements.memoryTypeBits, properties);
+    allocation.size = requirements.size;
+    allocation.category = category;
+    // without a granularity page to share, buffers and images can be in the same blocks
+    if (m_bufferImageGranularity <= 1) {
+        linear = true;
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    MemoryCategoryStatistics& categoryStatistics = m_categories.at(static_cast<size_t>(category));
+    // heap size of the memory type, a block is never more than an eighth of a small heap
+    VkDeviceSize heapSize = m_memoryProperties.memoryHeaps[m_memoryProperties.memoryTypes[allocation.memoryTypeIndex].heapIndex].size;
+    VkDeviceSize blockSize = std::min(m_blockSize, std::max<VkDeviceSize>(heapSize / 8, 1));
+
+    // big resources get their own memory, they would waste most of a block
+    if (requirements.size > blockSize / 2) {
+        if (!AllocateDeviceMemory(device, allocation.memoryTypeIndex, requirements.size, allocation.memory, allocation.mappedData)) {
+            throw std::runtime_error("Failed to allocate device memory!");
+        }
+        m_allocationCount++;
+        m_dedicatedAllocationCount++;
+        m_dedicatedBytes += requirements.size;
+        categoryStatistics.allocationCount++;
+        categoryStatistics.bytes += requirements.size;
+        categoryStatistics.peakBytes = std::max(categoryStatistics.peakBytes, categoryStatistics.bytes);
+        return allocation;
+    }
+
+    std::vector<std::unique_ptr<MemoryBlock>>& blocks = m_blocks[allocation.memoryTypeIndex];
+    VkDeviceSize alignment = std::max<VkDeviceSize>(requirements.alignment, 1);
+    VkDeviceSize offset = 0;
+    MemoryBlock* block = nullptr;
+    for (auto& candidate : blocks) {
+        if (candidate->linear == linear && candidate->ranges.Allocate(requirements.size, alignment, offset)) {
+            block = candidate.get();
+            break;
+        }
+    }
+    if (block == nullptr) {
+        block = CreateBlock(device, allocation.memoryTypeIndex, blockSize, linear);
+        if (!block->ranges.Allocate(requirements.size, alignment, offset)) {
+            throw std::runtime_error("Failed to allocate from a new memory block!");
+        }
+    }
+
+    block->allocationCount++;
+    m_allocationCount++;
+    categoryStatistics.allocationCount++;
+    categoryStatistics.bytes += requirements.size;
+    categoryStatistics.peakBytes = std::max(categoryStatistics.peakBytes, categoryStatistics.bytes);
+    allocation.memory = block->memory;
+    allocation.offset = offset;
+    allocation.block = block;
+    if (block->mappedData) {
+        allocation.mappedData = static_cast<char*>(block->mappedData) + offset;
+    }
+    return allocation;
+}
+
+void DeviceMemoryAllocator::Free(VkDevice &device, MemoryAllocation &allocation) {
+    if (allocation.memory == VK_NULL_HANDLE) {return;}
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_allocationCount--;
+    MemoryCategoryStatistics& categoryStatistics = m_categories.at(static_cast<size_t>(allocation.category));
+    categoryStatistics.allocationCount--;
+    categoryStatistics.bytes -= allocation.size;
+    if (allocation.block == nullptr) {
+        FreeDeviceMemory(device, allocation.memoryTypeIndex, allocation.size, allocation.memory);
+        m_dedicatedAllocationCount--;
+        m_dedicatedBytes -= allocation.size;
+    } else {
+        MemoryBlock* block = allocation.block;
+        block->ranges.Free(allocation.offset, allocation.size);
+        block->allocationCount--;
+        // keep one empty block of each kind, so that freeing and allocating again doesn't hit the driver
+        if (block->allocationCount == 0) {
+            auto& blocks = m_blocks[block->memoryTypeIndex];
+            auto emptyBlocks = std::count_if(blocks.begin(), blocks.end(), [&](const std::unique_ptr<MemoryBlock>& other) {
+                return other->linear == block->linear && other->allocationCount == 0;
+            });
+            if (emptyBlocks > 1) {
+                DestroyBlock(device, block);
+            }
+        }
+    }
+    allocation = MemoryAllocation();
+}
+
+MemoryBlock* DeviceMemoryAllocator::CreateBlock(VkDevice &device, uint32_t memoryTypeIndex, VkDeviceSize size, bool linear) {
+    std::unique_ptr<MemoryBlock> block(new MemoryBlock());
+    if (!AllocateDeviceMemory(device, memoryTypeIndex, size, block->memory, block->mappedData)) {
+        throw std::runtime_error("Failed to allocate device memory block!");
+    }
+    block->memoryTypeIndex = memoryTypeIndex;
+    block->linear = linear;
+    block->ranges.Reset(size);
+    m_blocks[memoryTypeIndex].push_back(std::move(block));
+    return m_blocks[memoryTypeIndex].back().get();
+}
+
+void DeviceMemoryAllocator::DestroyBlock(VkDevice &device, MemoryBlock *block) {
+    auto& blocks = m_blocks[block->memoryTypeIndex];
+    auto it = std::find_if(blocks.begin(), blocks.end(), [&](const std::unique_ptr<MemoryBlock>& other) {return other.get() == block;});
+    FreeDeviceMemory(device, block->memoryTypeIndex, block->ranges.GetSize(), block->memory);
+    blocks.erase(it);
+}
+
+bool DeviceMemoryAllocator::AllocateDeviceMemory(VkDevice &device, uint32_t memoryTypeIndex, VkDeviceSize size,
+                                                 VkDeviceMemory &memory, void *&mappedData) {
+    VkMemoryAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.allocationSize = size;
+    allocInfo.memoryTypeIndex = memoryTypeIndex;
+    if (vkAllocateMemory(device, &allocInfo, HostAllocator::GetCallbacks(), &memory) != VK_SUCCESS) {
+        return false;
+    }
+    // map host visible memory once, a memory object can only be mapped once at a time
+    mappedData = nullptr;
+    if (m_memoryProperties.memoryTypes[memoryTypeIndex].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) {
+        if (vkMapMemory(device, memory, 0, VK_WHOLE_SIZE, 0, &mappedData) != VK_SUCCESS) {
+            vkFreeMemory(device, memory, HostAllocator::GetCallbacks());
+            return false;
+        }
+    }
+    m_heapReservedBytes[m_memoryProperties.memoryTypes[memoryTypeIndex].heapIndex] += size;
+    m_reservedBytes += size;
+    m_peakReservedBytes = std::max(m_peakReservedBytes, m_reservedBytes);
+    return true;
+}
+
+void DeviceMemoryAllocator::FreeDeviceMemory(VkDevice &device, uint32_t memoryTypeIndex, VkDeviceSize size, VkDeviceMemory memory) {
+    vkFreeMemory(device, memory, HostAllocator::GetCallbacks());
+    m_heapReservedBytes[m_memoryProperties.memoryTypes[memoryTypeIndex].heapIndex] -= size;
+    m_reservedBytes -= size;
+}
+
+MemoryStatistics DeviceMemoryAllocator::GetStatistics() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    MemoryStatistics statistics;
+    statistics.allocationCount = m_allocationCount;
+    statistics.dedicatedAllocationCount = m_dedicatedAllocationCount;
+    statistics.reservedBytes = m_dedicatedBytes;
+    statistics.usedBytes = m_dedicatedBytes;
+    for (const auto& blocks : m_blocks) {
+        for (const auto& block : blocks) {
+            statistics.blockCount++;
+            VkDeviceSize freeBytes = block->ranges.GetFreeSize();
+            statistics.reservedBytes += block->ranges.GetSize();
+            statistics.usedBytes += block->ranges.GetSize() - freeBytes;
+            statistics.freeBytes += freeBytes;
+            statistics.fragmentedBytes += freeBytes - block->ranges.GetLargestFreeRange();
+        }
+    }
+    statistics.deviceMemoryCount = statistics.blockCount + statistics.dedicatedAllocationCount;
+    statistics.peakReservedBytes = m_peakReservedBytes;
+    statistics.categories = m_categories;
+    return statistics;
+}
+
+MemoryCategoryStatistics DeviceMemoryAllocator::GetCategoryStatistics(MemoryCategory category) const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_categories.at(static_cast<size_t>(category));
+}
+
+std::vector<MemoryHeapBudget> DeviceMemoryAllocator::GetHeapBudgets() const {
+    std::vector<MemoryHeapBudget> budgets(m_memoryProperties.memoryHeapCount);
+    VkPhysicalDeviceMemoryBudgetPropertiesEXT budgetProperties{};
+    budgetProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT;
+    if (m_getMemoryProperties2) {
+        // the budget changes with the other processes using the device, so it is queried every time
+        VkPhysicalDeviceMemoryProperties2 properties{};
+        properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2;
+        properties.pNext = &budgetProperties;
+        m_getMemoryProperties2(m_physicalDevice, &properties);
+    }
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (uint32_t i = 0; i < m_memoryProperties.memoryHeapCount; i++) {
+        budgets[i].flags = m_memoryProperties.memoryHeaps[i].flags;
+        budgets[i].size = m_memoryProperties.memoryHeaps[i].size;
+        budgets[i].budget = m_getMemoryProperties2 ? budgetProperties.heapBudget[i] : budgets[i].size;
+        budgets[i].usage = m_getMemoryProperties2 ? budgetProperties.heapUsage[i] : m_heapReservedBytes[i];
+    }
+    return budgets;
+}
+
+void DeviceMemoryAllocator::PrintStatistics(std::ostream &out) const {
+    MemoryStatistics statistics = GetStatistics();
+    const double megabyte = 1024.0 * 1024.0;
+    out << "Device memory: " << statistics.allocationCount << " allocations in " << statistics.deviceMemoryCount
+        << " device memory objects (" << statistics.blockCount << " blocks, " << statistics.dedicatedAllocationCount << " dedicated)" << std::endl;
+    out << std::fixed << std::setprecision(2);
+    out << "  reserved " << statistics.reservedBytes / megabyte << " MB, used " << statistics.usedBytes / megabyte
+        << " MB, free " << statistics.freeBytes / megabyte << " MB";
+    if (statistics.freeBytes > 0) {
+        out << " (" << 100.0 * statistics.fragmentedBytes / statistics.freeBytes << "% fragmented)";
+    }
+    out << ", peak reserved " << statistics.peakReservedBytes / megabyte << " MB" << std::endl;
+    for (size_t i = 0; i < statistics.categories.size(); i++) {
+        const MemoryCategoryStatistics& category = statistics.categories[i];
+        out << "  " << std::setw(9) << GetCategoryName(static_cast<MemoryCategory>(i)) << ": " << category.allocationCount
+            << " allocations, " << category.bytes / megabyte << " MB (peak " << category.peakBytes / megabyte << " MB)" << std::endl;
+    }
+    std::vector<MemoryHeapBudget> budgets = GetHeapBudgets();
+    for (size_t i = 0; i < budgets.size(); i++) {
+        out << "  heap " << i << ((budgets[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) ? " (device local)" : " (host)")
+            << ": usage " << budgets[i].usage / megabyte << " MB of " << (UsesMemoryBudget() ? "budget " : "size ")
+            << budgets[i].budget / megabyte << " MB" << std::endl;
+    }
+    out << std::defaultfloat;
+}
@@ -0,0 +1,152 @@
+#ifndef VULKANBASICS_DEVICEMEMORYALLOCATOR_H
+#define VULKANBASICS_DEVICEMEMORYALLOCATOR_H
+#include <vulkan/vulkan.h>
+#include <array>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <vector>
+#include "RangeAllocator.h"
+
+struct MemoryBlock;
+
+// what an allocation is used for, every allocation is accounted to one category
+enum class MemoryCategory {Vertex, Index, Uniform, Texture, Staging, Swapchain, Count};
+
+// a range of device memory handed out by the DeviceMemoryAllocator
+struct MemoryAllocation {
+    VkDeviceMemory memory = VK_NULL_HANDLE;
+    VkDeviceSize offset = 0;
+    VkDeviceSize size = 0;
+    // host address of the range if the memory is host visible (the blocks stay mapped)
+    void* mappedData = nullptr;
+    uint32_t memoryTypeIndex = 0;
+    MemoryCategory category = MemoryCategory::Count;
+    // block the range was sub-allocated from, nullptr for a dedicated allocation
+    MemoryBlock* block = nullptr;
+};
+
+// live allocations of one category
+struct MemoryCategoryStatistics {
+    uint64_t allocationCount = 0;
+    VkDeviceSize bytes = 0;
+    // high-water mark of bytes since Create()
+    VkDeviceSize peakBytes = 0;
+};
+
+// budget of a memory heap (VK_EXT_memory_budget), or the heap size and the allocator's own usage without the extension
+struct MemoryHeapBudget {
+    VkMemoryHeapFlags flags = 0;
+    VkDeviceSize size = 0;
+    // memory this process can allocate from the heap without degrading performance
+    VkDeviceSize budget = 0;
+    // memory of the heap in use by this process (all the allocations of the device with the extension)
+    VkDeviceSize usage = 0;
+};
+
+// how the memory heaps of the device relate to the host, classified once at Create()
+struct MemoryHeapClassification {
+    // every heap is device local: integrated GPUs and software drivers share the host memory
+    bool unifiedMemory = false;
+    // a device local memory type the host can map coherently (UMA, resizable BAR), UINT32_MAX if none
+    uint32_t hostVisibleDeviceLocalType = UINT32_MAX;
+    VkDeviceSize hostVisibleDeviceLocalHeapSize = 0;
+};
+
+// allocation counts and fragmentation of the allocator
+struct MemoryStatistics {
+    // live buffers/images
+    uint64_t allocationCount = 0;
+    // vkAllocateMemory calls currently alive (blocks and dedicated allocations)
+    uint64_t deviceMemoryCount = 0;
+    uint64_t blockCount = 0;
+    uint64_t dedicatedAllocationCount = 0;
+    // bytes allocated from the driver and bytes handed out
+    VkDeviceSize reservedBytes = 0;
+    VkDeviceSize usedBytes = 0;
+    // free bytes in the blocks, and the part of them not in the largest free range of their block
+    VkDeviceSize freeBytes = 0;
+    VkDeviceSize fragmentedBytes = 0;
+    // high-water mark of reservedBytes since Create()
+    VkDeviceSize peakReservedBytes = 0;
+    std::array<MemoryCategoryStatistics, static_cast<size_t>(MemoryCategory::Count)> categories;
+};
+
+// Sub-allocates buffers and images from large blocks of device memory, one list of blocks for each memory type.
+// Ranges in a block come from a RangeAllocator (best fit free-list). Linear resources (buffers) and optimal
+// tiling images are kept in separate blocks when bufferImageGranularity > 1, so they never share a
+// granularity page. Allocations bigger than half a block get their own vkAllocateMemory.
+// Allocations are accounted by category with high-water marks, the ones still alive at Destroy() are reported as leaks.
+class DeviceMemoryAllocator {
+public:
+    DeviceMemoryAllocator();
+    ~DeviceMemoryAllocator();
+
+    // VK_EXT_memory_budget can be enabled on the device (needs a 1.1 instance for vkGetPhysicalDeviceMemoryProperties2)
+    static bool IsMemoryBudgetSupported(VkPhysicalDevice& physicalDevice, uint32_t instanceApiVersion);
+    static const char* GetCategoryName(MemoryCategory category);
+
+    // useMemoryBudget: VK_EXT_memory_budget has been enabled on the device
+    // blockSize 0 picks 64 MB, smaller on small heaps
+    void Create(VkInstance& instance, VkPhysicalDevice& physicalDevice, bool useMemoryBudget, VkDeviceSize blockSize = 0);
+    // reports the allocations that were not freed
+    void Destroy(VkDevice& device);
+
+    // find a memory type matching the filter with all the property flags
+    uint32_t FindMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) const;
+    inline const VkPhysicalDeviceMemoryProperties& GetMemoryProperties() const {return m_memoryProperties;}
+    inline const MemoryHeapClassification& GetHeapClassification() const {return m_heapClassification;}
+    // size bytes of device local memory can be written by the host, so data the GPU reads can be written in place
+    // without a staging buffer and a copy (request DEVICE_LOCAL | HOST_VISIBLE | HOST_COHERENT).
+    // On discrete GPUs the host visible device local heap is a small window (often 256 MB), so only requests up to
+    // a fraction of it qualify, and the allocation can still fail when other resources filled the heap.
+    bool SupportsDirectUpload(VkDeviceSize size) const;
+    // largest request SupportsDirectUpload accepts, 0 if the host can't write device local memory
+    VkDeviceSize GetMaxDirectUploadSize() const;
+
+    // linear: buffers and linear tiling images, false for optimal tiling images
+    MemoryAllocation Allocate(VkDevice& device, const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties, bool linear, MemoryCategory category);
+    void Free(VkDevice& device, MemoryAllocation& allocation);
+
+    MemoryStatistics GetStatistics() const;
+    MemoryCategoryStatistics GetCategoryStatistics(MemoryCategory category) const;
+    // current budget and usage of each memory heap
+    std::vector<MemoryHeapBudget> GetHeapBudgets() const;
+    inline bool UsesMemoryBudget() const {return m_getMemoryProperties2 != nullptr;}
+    void PrintStatistics(std::ostream& out) const;
+
+private:
+    MemoryBlock* CreateBlock(VkDevice& device, uint32_t memoryTypeIndex, VkDeviceSize size, bool linear);
+    void DestroyBlock(VkDevice& device, MemoryBlock* block);
+    // allocate and map device memory, false if the heap is out of memory
+    bool AllocateDeviceMemory(VkDevice& device, uint32_t memoryTypeIndex, VkDeviceSize size, VkDeviceMemory& memory, void*& mappedData);
+    void FreeDeviceMemory(VkDevice& device, uint32_t memoryTypeIndex, VkDeviceSize size, VkDeviceMemory memory);
+    void ClassifyHeaps();
+
+private:
+    VkPhysicalDevice m_physicalDevice = VK_NULL_HANDLE;
+    VkPhysicalDeviceMemoryProperties m_memoryProperties{};
+    MemoryHeapClassification m_heapClassification;
+    // loaded if the memory budget is used
+    PFN_vkGetPhysicalDeviceMemoryProperties2 m_getMemoryProperties2 = nullptr;
+    VkDeviceSize m_bufferImageGranularity = 1;
+    VkDeviceSize m_blockSize = 0;
+
+    // blocks of each memory type
+    std::vector<std::vector<std::unique_ptr<MemoryBlock>>> m_blocks;
+    uint64_t m_allocationCount = 0;
+    uint64_t m_dedicatedAllocationCount = 0;
+    VkDeviceSize m_dedicatedBytes = 0;
+
+    // device memory allocated from each heap, and the high-water mark of all of them
+    std::vector<VkDeviceSize> m_heapReservedBytes;
+    VkDeviceSize m_reservedBytes = 0;
+    VkDeviceSize m_peakReservedBytes = 0;
+    std::array<MemoryCategoryStatistics, static_cast<size_t>(MemoryCategory::Count)> m_categories;
+
+    // objects may be created from several threads
+    mutable std::mutex m_mutex;
+};
+
+
+#endif //VULKANBASICS_DEVICEMEMORYALLOCATOR_H
@@ -0,0 +1,123 @@
+#include "FramePacer.h"
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <thread>
+
+// the remaining time below this is spun instead of slept
+#define FRAME_PACER_SPIN_MICROSECONDS 1000
+
+FramePacer::FramePacer(size_t intervalCapacity) {
+    m_intervals.resize(std::max<size_t>(intervalCapacity, 1));
+}
+
+void FramePacer::SetTargetFps(double targetFps) {
+    m_targetFps = targetFps > 0.0 ? targetFps : 0.0;
+    m_targetInterval = m_targetFps > 0.0 ?
+            std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(1.0 / m_targetFps)) :
+            std::chrono::steady_clock::duration(0);
+    m_nextFrameTime = std::chrono::steady_clock::now() + m_targetInterval;
+}
+
+void FramePacer::Pace() {
+    if (m_targetFps > 0.0) {
+        WaitUntil(m_nextFrameTime);
+        auto now = std::chrono::steady_clock::now();
+        m_nextFrameTime += m_targetInterval;
+        // a frame took longer than a whole interval, don't try to catch up with a burst of frames
+        if (m_nextFrameTime < now) {
+            m_nextFrameTime = now + m_targetInterval;
+        }
+    }
+
+    auto now = std::chrono::steady_clock::now();
+    if (m_hasLastFrame) {
+        m_intervals[m_intervalCount % m_intervals.size()] =
+                std::chrono::duration_cast<std::chrono::nanoseconds>(now - m_lastFrameTime).count();
+        m_intervalCount++;
+    }
+    m_lastFrameTime = now;
+    m_hasLastFrame = true;
+}
+
+void FramePacer::Reset() {
+    m_intervalCount = 0;
+    m_hasLastFrame = false;
+    m_nextFrameTime = std::chrono::steady_clock::now() + m_targetInterval;
+}
+
+void FramePacer::WaitUntil(std::chrono::steady_clock::time_point deadline) {
+    auto spinStart = deadline - std::chrono::microseconds(FRAME_PACER_SPIN_MICROSECONDS);
+    if (std::chrono::steady_clock::now() < spinStart) {
+        std::this_thread::sleep_until(spinStart);
+    }
+    while (std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::yield();
+    }
+}
+
+FramePacingReport FramePacer::GetReport() const {
+    FramePacingReport report;
+    report.targetInterval = m_targetFps > 0.0 ? 1000.0 / m_targetFps : 0.0;
+    size_t count = static_cast<size_t>(std::min<uint64_t>(m_intervalCount, m_intervals.size()));
+    report.frameCount = count;
+    if (count == 0) {return report;}
+
+    // intervals in the order they were recorded
+    uint64_t first = m_intervalCount - count;
+    std::vector<double> milliseconds(count);
+    for (size_t i = 0; i < count; i++) {
+        milliseconds[i] = m_intervals[(first + i) % m_intervals.size()] / 1.0e6;
+    }
+
+    double sum = 0.0, deltaSum = 0.0;
+    for (size_t i = 0; i < count; i++) {
+        sum += milliseconds[i];
+        if (i > 0) {
+            deltaSum += std::abs(milliseconds[i] - milliseconds[i - 1]);
+        }
+    }
+    report.meanInterval = sum / count;
+    report.intervalDelta = count > 1 ? deltaSum / (count - 1) : 0.0;
+    double squareSum = 0.0;
+    for (double interval : milliseconds) {
+        squareSum += (interval - report.meanInterval) * (interval - report.meanInterval);
+    }
+    report.jitter = std::sqrt(squareSum / count);
+
+    std::sort(milliseconds.begin(), milliseconds.end());
+    report.minInterval = milliseconds.front();
+    report.maxInterval = milliseconds.back();
+    // nearest-rank percentile
+    size_t rank = static_cast<size_t>(std::ceil(0.99 * count));
+    report.p99Interval = milliseconds[std::max<size_t>(rank, 1) - 1];
+    return report;
+}
+
+void FramePacer::PrintReport(std::ostream &out) const {
+    FramePacingReport report = GetReport();
+    out << "Frame pacing of the last " << report.frameCount << " frames (ms):" << std::endl;
+    out << std::fixed << std::setprecision(3);
+    if (report.targetInterval > 0.0) {
+        out << "  target interval " << report.targetInterval << std::endl;
+    }
+    out << "  interval mean " << report.meanInterval << ", min " << report.minInterval << ", max " << report.maxInterval
+        << ", p99 " << report.p99Interval << std::endl;
+    out << "  jitter (std dev) " << report.jitter << ", mean frame-to-frame delta " << report.intervalDelta << std::endl;
+    out << std::defaultfloat;
+}
+
+const char *FramePacer::GetPolicyName(PresentPolicy policy) {
+    switch (policy) {
+        case PresentPolicy::LowLatency: return "low latency";
+        case PresentPolicy::VSync: return "vsync";
+        case PresentPolicy::Uncapped: return "uncapped";
+        case PresentPolicy::TargetFps: return "target fps";
+        case PresentPolicy::Count: break;
+    }
+    return "unknown";
+}
+
+PresentPolicy FramePacer::GetNextPolicy(PresentPolicy policy) {
+    return static_cast<PresentPolicy>((static_cast<int>(policy) + 1) % static_cast<int>(PresentPolicy::Count));
+}
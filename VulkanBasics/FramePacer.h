@@ -0,0 +1,79 @@
+#ifndef VULKANBASICS_FRAMEPACER_H
+#define VULKANBASICS_FRAMEPACER_H
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+// how frames are paced and presented
+enum class PresentPolicy {
+    // MAILBOX, then IMMEDIATE: the newest frame is shown at the next vblank, no tearing with MAILBOX
+    LowLatency = 0,
+    // FIFO: frames are capped to the refresh rate of the display, lowest power
+    VSync,
+    // IMMEDIATE, then MAILBOX: never wait for the display, for measuring throughput
+    Uncapped,
+    // low latency present mode, capped to a target frame rate by sleeping on the CPU
+    TargetFps,
+    // number of policies, not a policy
+    Count
+};
+
+// frame-to-frame intervals measured at the pacing point of the main loop (milliseconds)
+struct FramePacingReport {
+    size_t frameCount = 0;
+    double meanInterval = 0.0;
+    double minInterval = 0.0;
+    double maxInterval = 0.0;
+    double p99Interval = 0.0;
+    // standard deviation of the intervals
+    double jitter = 0.0;
+    // mean absolute difference between two consecutive intervals
+    double intervalDelta = 0.0;
+    // 0 if no target frame rate is set
+    double targetInterval = 0.0;
+};
+
+// Frame limiter and frame-to-frame jitter measurement.
+// Pace() is called once per frame by the main loop, it sleeps until the next frame is due when a
+// target frame rate is set, then records the time since the previous call.
+class FramePacer {
+public:
+    explicit FramePacer(size_t intervalCapacity = 4096);
+
+    // 0 disables the limiter
+    void SetTargetFps(double targetFps);
+    inline double GetTargetFps() const {return m_targetFps;}
+
+    // wait for the next frame (if limited) and record the frame interval
+    void Pace();
+    // forget the recorded intervals, e.g. after changing the policy
+    void Reset();
+
+    FramePacingReport GetReport() const;
+    void PrintReport(std::ostream& out) const;
+
+    static const char* GetPolicyName(PresentPolicy policy);
+    // the policy after policy, wrapping around after the last one
+    static PresentPolicy GetNextPolicy(PresentPolicy policy);
+
+private:
+    // sleep until the deadline, the last part is spun because sleeping overshoots by up to a scheduler tick
+    static void WaitUntil(std::chrono::steady_clock::time_point deadline);
+
+private:
+    double m_targetFps = 0.0;
+    std::chrono::steady_clock::duration m_targetInterval{0};
+    // when the next frame is due
+    std::chrono::steady_clock::time_point m_nextFrameTime;
+    // end of the previous Pace() call
+    std::chrono::steady_clock::time_point m_lastFrameTime;
+    bool m_hasLastFrame = false;
+
+    // ring of the recent intervals (nanoseconds)
+    std::vector<uint64_t> m_intervals;
+    uint64_t m_intervalCount = 0;
+};
+
+
+#endif //VULKANBASICS_FRAMEPACER_H
@@ -0,0 +1,164 @@
+#include "FrameProfiler.h"
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <stdexcept>
+#include <vector>
+
+FrameProfiler::FrameProfiler(size_t frameCapacity) {
+    // one frame of the ring is always being written, so keep at least one more to read
+    m_frameCapacity = std::max<size_t>(frameCapacity, 2);
+    m_samples.reset(new std::atomic<uint64_t>[m_frameCapacity * FRAME_PHASE_COUNT]);
+    for (size_t i = 0; i < m_frameCapacity * FRAME_PHASE_COUNT; i++) {
+        m_samples[i].store(0, std::memory_order_relaxed);
+    }
+}
+
+void FrameProfiler::BeginFrame() {
+    if (!m_enabled) {return;}
+    // clear the slot, phases that are skipped in this frame (e.g. present in headless mode) stay 0
+    uint64_t frame = m_finishedFrames.load(std::memory_order_relaxed);
+    for (size_t phase = 0; phase < FRAME_PHASE_COUNT; phase++) {
+        Sample(frame, phase).store(0, std::memory_order_relaxed);
+    }
+    m_frameStartTime = std::chrono::steady_clock::now();
+}
+
+void FrameProfiler::EndFrame() {
+    if (!m_enabled) {return;}
+    auto frameTime = std::chrono::steady_clock::now() - m_frameStartTime;
+    Record(FramePhase::Frame, std::chrono::duration_cast<std::chrono::nanoseconds>(frameTime).count());
+    // publish the frame to the readers
+    m_finishedFrames.fetch_add(1, std::memory_order_release);
+}
+
+void FrameProfiler::Record(FramePhase phase, uint64_t nanoseconds) {
+    if (!m_enabled) {return;}
+    uint64_t frame = m_finishedFrames.load(std::memory_order_relaxed);
+    // a phase can be recorded several times in a frame, e.g. waiting for two fences
+    std::atomic<uint64_t>& sample = Sample(frame, static_cast<size_t>(phase));
+    sample.store(sample.load(std::memory_order_relaxed) + nanoseconds, std::memory_order_relaxed);
+}
+
+void FrameProfiler::GetReadableFrames(uint64_t &firstFrame, uint64_t &frameCount) const {
+    uint64_t finishedFrames = m_finishedFrames.load(std::memory_order_acquire);
+    // the slot of the frame being recorded is skipped
+    frameCount = std::min<uint64_t>(finishedFrames, m_frameCapacity - 1);
+    firstFrame = finishedFrames - frameCount;
+}
+
+FrameTimingReport FrameProfiler::GetReport() const {
+    FrameTimingReport report;
+    uint64_t firstFrame, frameCount;
+    GetReadableFrames(firstFrame, frameCount);
+    report.frameCount = frameCount;
+    if (frameCount == 0) {return report;}
+
+    std::vector<double> milliseconds(frameCount);
+    for (size_t phase = 0; phase < FRAME_PHASE_COUNT; phase++) {
+        double sum = 0.0;
+        for (uint64_t i = 0; i < frameCount; i++) {
+            milliseconds[i] = Sample(firstFrame + i, phase).load(std::memory_order_relaxed) / 1.0e6;
+            sum += milliseconds[i];
+        }
+        std::sort(milliseconds.begin(), milliseconds.end());
+        // nearest-rank percentile
+        auto percentile = [&](double p) {
+            size_t rank = static_cast<size_t>(std::ceil(p * frameCount));
+            return milliseconds[std::min<size_t>(std::max<size_t>(rank, 1), frameCount) - 1];
+        };
+        FramePhaseStatistics& statistics = report.phases[phase];
+        statistics.mean = sum / frameCount;
+        statistics.p50 = percentile(0.50);
+        statistics.p95 = percentile(0.95);
+        statistics.p99 = percentile(0.99);
+        statistics.max = milliseconds.back();
+    }
+    return report;
+}
+
+void FrameProfiler::PrintReport(std::ostream &out) const {
+    FrameTimingReport report = GetReport();
+    out << "CPU frame timings of the last " << report.frameCount << " frames (ms):" << std::endl;
+    out << std::left << std::setw(16) << "phase" << std::right << std::setw(10) << "mean" << std::setw(10) << "p50"
+        << std::setw(10) << "p95" << std::setw(10) << "p99" << std::setw(10) << "max" << std::endl;
+    out << std::fixed << std::setprecision(3);
+    for (size_t phase = 0; phase < FRAME_PHASE_COUNT; phase++) {
+        const FramePhaseStatistics& statistics = report.phases[phase];
+        out << std::left << std::setw(16) << GetPhaseName(static_cast<FramePhase>(phase)) << std::right
+            << std::setw(10) << statistics.mean << std::setw(10) << statistics.p50 << std::setw(10) << statistics.p95
+            << std::setw(10) << statistics.p99 << std::setw(10) << statistics.max << std::endl;
+    }
+    out << std::defaultfloat;
+}
+
+void FrameProfiler::ExportCSV(const std::string &fileName) const {
+    std::ofstream file(fileName);
+    if (!file.is_open()) {
+        throw std::runtime_error("Failed to open file: " + fileName);
+    }
+    // header
+    file << "frame";
+    for (size_t phase = 0; phase < FRAME_PHASE_COUNT; phase++) {
+        file << "," << GetPhaseName(static_cast<FramePhase>(phase)) << "_ms";
+    }
+    file << "\n";
+
+    uint64_t firstFrame, frameCount;
+    GetReadableFrames(firstFrame, frameCount);
+    for (uint64_t frame = firstFrame; frame < firstFrame + frameCount; frame++) {
+        file << frame;
+        for (size_t phase = 0; phase < FRAME_PHASE_COUNT; phase++) {
+            file << "," << Sample(frame, phase).load(std::memory_order_relaxed) / 1.0e6;
+        }
+        file << "\n";
+    }
+}
+
+void FrameProfiler::ExportJSON(const std::string &fileName) const {
+    std::ofstream file(fileName);
+    if (!file.is_open()) {
+        throw std::runtime_error("Failed to open file: " + fileName);
+    }
+    FrameTimingReport report = GetReport();
+    file << "{\n  \"frames\": " << report.frameCount << ",\n  \"phases\": {\n";
+    for (size_t phase = 0; phase < FRAME_PHASE_COUNT; phase++) {
+        const FramePhaseStatistics& statistics = report.phases[phase];
+        file << "    \"" << GetPhaseName(static_cast<FramePhase>(phase)) << "\": {\"mean_ms\": " << statistics.mean
+             << ", \"p50_ms\": " << statistics.p50 << ", \"p95_ms\": " << statistics.p95
+             << ", \"p99_ms\": " << statistics.p99 << ", \"max_ms\": " << statistics.max << "}";
+        file << (phase + 1 < FRAME_PHASE_COUNT ? ",\n" : "\n");
+    }
+    file << "  }\n}\n";
+}
+
+const char *FrameProfiler::GetPhaseName(FramePhase phase) {
+    switch (phase) {
+        case FramePhase::Simulate: return "simulate";
+        case FramePhase::Wait: return "wait";
+        case FramePhase::Acquire: return "acquire";
+        case FramePhase::UpdateUniforms: return "update_uniforms";
+        case FramePhase::Record: return "record";
+        case FramePhase::Submit: return "submit";
+        case FramePhase::Present: return "present";
+        case FramePhase::Frame: return "frame";
+        case FramePhase::Count: break;
+    }
+    return "unknown";
+}
+
+ScopedFrameTimer::ScopedFrameTimer(FrameProfiler &profiler, FramePhase phase) {
+    // don't read the clock at all when profiling is off
+    m_profiler = profiler.IsEnabled() ? &profiler : nullptr;
+    m_phase = phase;
+    if (m_profiler) {
+        m_startTime = std::chrono::steady_clock::now();
+    }
+}
+
+ScopedFrameTimer::~ScopedFrameTimer() {
+    if (!m_profiler) {return;}
+    auto duration = std::chrono::steady_clock::now() - m_startTime;
+    m_profiler->Record(m_phase, std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count());
+}
@@ -0,0 +1,93 @@
+#ifndef VULKANBASICS_FRAMEPROFILER_H
+#define VULKANBASICS_FRAMEPROFILER_H
+#include <atomic>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <string>
+
+// phases of a frame measured on the CPU
+enum class FramePhase{Simulate = 0, Wait, Acquire, UpdateUniforms, Record, Submit, Present, Frame, Count};
+
+constexpr size_t FRAME_PHASE_COUNT = static_cast<size_t>(FramePhase::Count);
+
+// statistics of one phase over the recorded frames (milliseconds)
+struct FramePhaseStatistics {
+    double mean = 0.0;
+    double p50 = 0.0;
+    double p95 = 0.0;
+    double p99 = 0.0;
+    double max = 0.0;
+};
+
+struct FrameTimingReport {
+    // number of frames the statistics are computed from
+    size_t frameCount = 0;
+    std::array<FramePhaseStatistics, FRAME_PHASE_COUNT> phases{};
+};
+
+// Records the CPU time of each frame phase into a fixed size ring buffer.
+// The render thread is the only writer, reports can be requested from any thread without locking,
+// a report taken while the ring wraps around may mix a few samples from two different frames.
+class FrameProfiler {
+public:
+    explicit FrameProfiler(size_t frameCapacity = 4096);
+
+    inline void SetEnabled(bool enabled){m_enabled = enabled;}
+    inline bool IsEnabled() const {return m_enabled;}
+
+    // start and finish the timing of a frame, the whole frame is recorded as FramePhase::Frame
+    void BeginFrame();
+    void EndFrame();
+
+    // record the duration of a phase of the current frame
+    void Record(FramePhase phase, uint64_t nanoseconds);
+
+    // p50/p95/p99 of the frames in the ring buffer
+    FrameTimingReport GetReport() const;
+    void PrintReport(std::ostream& out) const;
+
+    // raw samples of each frame as CSV, the report as JSON
+    void ExportCSV(const std::string& fileName) const;
+    void ExportJSON(const std::string& fileName) const;
+
+    static const char* GetPhaseName(FramePhase phase);
+
+private:
+    // index of the oldest frame that can be read and the number of frames to read
+    void GetReadableFrames(uint64_t& firstFrame, uint64_t& frameCount) const;
+
+    inline std::atomic<uint64_t>& Sample(uint64_t frame, size_t phase) const {
+        return m_samples[(frame % m_frameCapacity) * FRAME_PHASE_COUNT + phase];
+    }
+
+private:
+    bool m_enabled = true;
+    size_t m_frameCapacity;
+    // nanoseconds of each phase, FRAME_PHASE_COUNT samples for each frame
+    std::unique_ptr<std::atomic<uint64_t>[]> m_samples;
+    // number of frames finished, the frame being recorded is m_finishedFrames % m_frameCapacity
+    std::atomic<uint64_t> m_finishedFrames{0};
+
+    std::chrono::steady_clock::time_point m_frameStartTime;
+};
+
+// measures the time from its construction to its destruction as one phase of the frame
+class ScopedFrameTimer {
+public:
+    ScopedFrameTimer(FrameProfiler& profiler, FramePhase phase);
+    ~ScopedFrameTimer();
+
+    ScopedFrameTimer(const ScopedFrameTimer&) = delete;
+    ScopedFrameTimer& operator=(const ScopedFrameTimer&) = delete;
+
+private:
+    FrameProfiler* m_profiler;
+    FramePhase m_phase;
+    std::chrono::steady_clock::time_point m_startTime;
+};
+
+
+#endif //VULKANBASICS_FRAMEPROFILER_H
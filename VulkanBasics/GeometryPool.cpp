@@ -0,0 +1,143 @@
+#include "GeometryPool.h"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include "VulkanHelperFunctions.h"
+
+void GeometryPool::Create(VkDevice &device, DeviceMemoryAllocator &allocator, uint32_t vertexCapacity, uint32_t indexCapacity,
+                          const std::vector<uint32_t> &concurrentQueueFamilies) {
+    m_concurrentQueueFamilies = concurrentQueueFamilies;
+    m_vertexRanges.Reset(std::max<uint32_t>(vertexCapacity, 1));
+    m_indexRanges.Reset(std::max<uint32_t>(indexCapacity, 1));
+    CreateBuffers(device, allocator, true);
+}
+
+void GeometryPool::Destroy(VkDevice &device, DeviceMemoryAllocator &allocator) {
+    DestroyBuffers(device, allocator);
+    m_vertexRanges.Reset(0);
+    m_indexRanges.Reset(0);
+}
+
+bool GeometryPool::HasRoom(uint32_t vertexCount, uint32_t indexCount) const {
+    return m_vertexRanges.GetLargestFreeRange() >= vertexCount && m_indexRanges.GetLargestFreeRange() >= indexCount;
+}
+
+bool GeometryPool::Reserve(VkDevice &device, DeviceMemoryAllocator &allocator, UploadContext &uploadContext, uint32_t vertexCount, uint32_t indexCount,
+                           RetiredGeometryBuffers &retiredBuffers) {
+    if (HasRoom(vertexCount, indexCount)) {return false;}
+    VkDeviceSize oldVertexBytes = sizeof(Vertex) * m_vertexRanges.GetSize();
+    VkDeviceSize oldIndexBytes = sizeof(uint32_t) * m_indexRanges.GetSize();
+    // at least double, so that adding meshes one by one recreates the buffers a logarithmic number of times
+    if (m_vertexRanges.GetLargestFreeRange() < vertexCount) {
+        m_vertexRanges.Grow(std::max(m_vertexRanges.GetSize() * 2, m_vertexRanges.GetSize() + vertexCount));
+    }
+    if (m_indexRanges.GetLargestFreeRange() < indexCount) {
+        m_indexRanges.Grow(std::max(m_indexRanges.GetSize() * 2, m_indexRanges.GetSize() + indexCount));
+    }
+    retiredBuffers.vertexBuffer = m_vertexBuffer;
+    retiredBuffers.vertexMemory = m_vertexBufferMemory;
+    retiredBuffers.indexBuffer = m_indexBuffer;
+    retiredBuffers.indexMemory = m_indexBufferMemory;
+    m_vertexBuffer = VK_NULL_HANDLE;
+    m_vertexBufferMemory = MemoryAllocation();
+    m_indexBuffer = VK_NULL_HANDLE;
+    m_indexBufferMemory = MemoryAllocation();
+
+    // a staged pool stays staged: a copy on the GPU into mapped memory would race the host writes of the next meshes
+    bool wasDirectUpload = m_directUpload;
+    CreateBuffers(device, allocator, wasDirectUpload);
+    // the ranges keep their offsets, so the old contents go to the beginning of the new buffers
+    if (m_directUpload) {
+        memcpy(m_vertexBufferMemory.mappedData, retiredBuffers.vertexMemory.mappedData, (size_t) oldVertexBytes);
+        memcpy(m_indexBufferMemory.mappedData, retiredBuffers.indexMemory.mappedData, (size_t) oldIndexBytes);
+    } else {
+        uploadContext.CopyBufferContents(device, retiredBuffers.vertexBuffer, m_vertexBuffer, oldVertexBytes);
+        uploadContext.CopyBufferContents(device, retiredBuffers.indexBuffer, m_indexBuffer, oldIndexBytes);
+    }
+    return true;
+}
+
+bool GeometryPool::Allocate(uint32_t vertexCount, uint32_t indexCount, GeometryRange &range) {
+    uint64_t firstVertex = 0;
+    uint64_t firstIndex = 0;
+    if (!m_vertexRanges.Allocate(vertexCount, 1, firstVertex)) {return false;}
+    if (!m_indexRanges.Allocate(indexCount, 1, firstIndex)) {
+        m_vertexRanges.Free(firstVertex, vertexCount);
+        return false;
+    }
+    range.firstVertex = static_cast<uint32_t>(firstVertex);
+    range.vertexCount = vertexCount;
+    range.firstIndex = static_cast<uint32_t>(firstIndex);
+    range.indexCount = indexCount;
+    return true;
+}
+
+void GeometryPool::Free(GeometryRange &range) {
+    m_vertexRanges.Free(range.firstVertex, range.vertexCount);
+    m_indexRanges.Free(range.firstIndex, range.indexCount);
+    range = GeometryRange();
+}
+
+void GeometryPool::Upload(VkDevice &device, DeviceMemoryAllocator &allocator, StagingArena &stagingArena, UploadContext &uploadContext,
+                          const GeometryRange &range, const std::vector<Vertex> &vertices, const std::vector<uint32_t> &indices) {
+    if (vertices.size() != range.vertexCount || indices.size() != range.indexCount) {
+        throw std::runtime_error("Failed to upload geometry, the mesh doesn't match its ranges!");
+    }
+    VkDeviceSize vertexBytes = sizeof(Vertex) * vertices.size();
+    VkDeviceSize indexBytes = sizeof(uint32_t) * indices.size();
+    if (m_directUpload) {
+        // the ranges are not in use by any frame, the host writes are visible to the next submission (coherent memory)
+        memcpy(static_cast<char*>(m_vertexBufferMemory.mappedData) + sizeof(Vertex) * range.firstVertex, vertices.data(), (size_t) vertexBytes);
+        memcpy(static_cast<char*>(m_indexBufferMemory.mappedData) + sizeof(uint32_t) * range.firstIndex, indices.data(), (size_t) indexBytes);
+        return;
+    }
+
+    StagingAllocation vertexStaging = stagingArena.Allocate(device, allocator, vertexBytes);
+    memcpy(vertexStaging.mappedData, vertices.data(), (size_t) vertexBytes);
+    uploadContext.CopyBuffer(device, vertexStaging, m_vertexBuffer, vertexBytes, sizeof(Vertex) * range.firstVertex);
+
+    StagingAllocation indexStaging = stagingArena.Allocate(device, allocator, indexBytes);
+    memcpy(indexStaging.mappedData, indices.data(), (size_t) indexBytes);
+    uploadContext.CopyBuffer(device, indexStaging, m_indexBuffer, indexBytes, sizeof(uint32_t) * range.firstIndex);
+}
+
+void GeometryPool::CmdBind(VkCommandBuffer commandBuffer) const {
+    VkBuffer vertexBuffers[] = {m_vertexBuffer};
+    VkDeviceSize offsets[] = {0};
+    vkCmdBindVertexBuffers(commandBuffer, 0, 1, vertexBuffers, offsets);
+    vkCmdBindIndexBuffer(commandBuffer, m_indexBuffer, 0, VK_INDEX_TYPE_UINT32);
+}
+
+void GeometryPool::CreateBuffers(VkDevice &device, DeviceMemoryAllocator &allocator, bool allowDirectUpload) {
+    VkDeviceSize totalBytes = sizeof(Vertex) * m_vertexRanges.GetSize() + sizeof(uint32_t) * m_indexRanges.GetSize();
+    m_directUpload = allowDirectUpload && allocator.SupportsDirectUpload(totalBytes);
+    if (m_directUpload) {
+        try {
+            CreateBuffersInMemory(device, allocator, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+            return;
+        } catch (const std::runtime_error&) {
+            // the host visible device local heap is full, stage the uploads instead
+            DestroyBuffers(device, allocator);
+            m_directUpload = false;
+        }
+    }
+    CreateBuffersInMemory(device, allocator, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+}
+
+void GeometryPool::CreateBuffersInMemory(VkDevice &device, DeviceMemoryAllocator &allocator, VkMemoryPropertyFlags properties) {
+    VulkanHelperFunctions::CreateBuffer(device, allocator, sizeof(Vertex) * m_vertexRanges.GetSize(),
+                                        VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+                                        properties, MemoryCategory::Vertex, m_vertexBuffer, m_vertexBufferMemory, m_concurrentQueueFamilies);
+    VulkanHelperFunctions::CreateBuffer(device, allocator, sizeof(uint32_t) * m_indexRanges.GetSize(),
+                                        VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
+                                        properties, MemoryCategory::Index, m_indexBuffer, m_indexBufferMemory, m_concurrentQueueFamilies);
+}
+
+void GeometryPool::DestroyBuffers(VkDevice &device, DeviceMemoryAllocator &allocator) {
+    if (m_vertexBuffer != VK_NULL_HANDLE) {
+        VulkanHelperFunctions::DestroyBuffer(device, allocator, m_vertexBuffer, m_vertexBufferMemory);
+    }
+    if (m_indexBuffer != VK_NULL_HANDLE) {
+        VulkanHelperFunctions::DestroyBuffer(device, allocator, m_indexBuffer, m_indexBufferMemory);
+    }
+}
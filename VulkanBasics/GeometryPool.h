@@ -0,0 +1,97 @@
+#ifndef VULKANBASICS_GEOMETRYPOOL_H
+#define VULKANBASICS_GEOMETRYPOOL_H
+#include <vulkan/vulkan.h>
+#include <cstdint>
+#include <vector>
+#include "Vertex.h"
+#include "RangeAllocator.h"
+#include "DeviceMemoryAllocator.h"
+#include "StagingArena.h"
+#include "UploadContext.h"
+
+// vertices and indices of one mesh in the geometry pool
+struct GeometryRange {
+    // first vertex of the mesh, added to its indices when drawing (vertexOffset of vkCmdDrawIndexed)
+    uint32_t firstVertex = 0;
+    uint32_t vertexCount = 0;
+    uint32_t firstIndex = 0;
+    uint32_t indexCount = 0;
+};
+
+// buffers of the pool replaced by Reserve(), to be destroyed once no submission uses them
+struct RetiredGeometryBuffers {
+    VkBuffer vertexBuffer = VK_NULL_HANDLE;
+    MemoryAllocation vertexMemory;
+    VkBuffer indexBuffer = VK_NULL_HANDLE;
+    MemoryAllocation indexMemory;
+};
+
+// One device local vertex buffer and one index buffer shared by all the meshes.
+// Each mesh gets a range of vertices and a range of indices (indices stay relative to the mesh's first vertex),
+// so the scene binds its geometry once and every draw only selects its ranges.
+// Free ranges are managed by a RangeAllocator in units of vertices and indices.
+// With uploads on a transfer queue, the buffers are concurrent over the transfer and graphics queue families:
+// ranges are written while the graphics queue draws from the others, which exclusive ownership can't express.
+// If the host can write device local memory of the buffers' size (DeviceMemoryAllocator::SupportsDirectUpload), the buffers
+// are mapped and meshes are copied into them directly, otherwise they go through the staging arena and a copy command.
+// The choice is made again whenever the buffers grow (a pool that fell back to staging stays staged),
+// and falls back to staging if the direct allocation fails.
+class GeometryPool {
+public:
+    // concurrentQueueFamilies: UploadContext::GetConcurrentQueueFamilies() of the uploads
+    void Create(VkDevice& device, DeviceMemoryAllocator& allocator, uint32_t vertexCapacity, uint32_t indexCapacity,
+                const std::vector<uint32_t>& concurrentQueueFamilies);
+    void Destroy(VkDevice& device, DeviceMemoryAllocator& allocator);
+
+    // a mesh of vertexCount vertices and indexCount indices fits without growing the pool
+    bool HasRoom(uint32_t vertexCount, uint32_t indexCount) const;
+    // grow the buffers if the mesh doesn't fit, true if they were replaced: the ranges keep their offsets and contents,
+    // which are copied into the new buffers by the host (direct uploads) or by a copy recorded into the upload batch.
+    // The old buffers are handed back in retiredBuffers, the frames in flight and the copy may still read them.
+    bool Reserve(VkDevice& device, DeviceMemoryAllocator& allocator, UploadContext& uploadContext, uint32_t vertexCount, uint32_t indexCount,
+                 RetiredGeometryBuffers& retiredBuffers);
+
+    // reserve the ranges of a mesh, false if the pool has no room for it
+    bool Allocate(uint32_t vertexCount, uint32_t indexCount, GeometryRange& range);
+    // give back the ranges of a mesh, no frame may still draw it
+    void Free(GeometryRange& range);
+
+    // write the mesh data to its ranges, or stage it and record copying it into the upload batch
+    void Upload(VkDevice& device, DeviceMemoryAllocator& allocator, StagingArena& stagingArena, UploadContext& uploadContext,
+                const GeometryRange& range, const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices);
+
+    // bind the vertex and index buffers for all the following draws
+    void CmdBind(VkCommandBuffer commandBuffer) const;
+
+    inline bool UsesDirectUpload() const {return m_directUpload;}
+    inline VkBuffer GetVertexBuffer() const {return m_vertexBuffer;}
+    inline VkBuffer GetIndexBuffer() const {return m_indexBuffer;}
+    inline uint32_t GetVertexCapacity() const {return static_cast<uint32_t>(m_vertexRanges.GetSize());}
+    inline uint32_t GetIndexCapacity() const {return static_cast<uint32_t>(m_indexRanges.GetSize());}
+    inline uint32_t GetUsedVertexCount() const {return static_cast<uint32_t>(m_vertexRanges.GetSize() - m_vertexRanges.GetFreeSize());}
+    inline uint32_t GetUsedIndexCount() const {return static_cast<uint32_t>(m_indexRanges.GetSize() - m_indexRanges.GetFreeSize());}
+
+private:
+    // direct upload buffers if allowed and the heap allows it, staged ones otherwise
+    void CreateBuffers(VkDevice& device, DeviceMemoryAllocator& allocator, bool allowDirectUpload);
+    void CreateBuffersInMemory(VkDevice& device, DeviceMemoryAllocator& allocator, VkMemoryPropertyFlags properties);
+    void DestroyBuffers(VkDevice& device, DeviceMemoryAllocator& allocator);
+
+private:
+    VkBuffer m_vertexBuffer = VK_NULL_HANDLE;
+    MemoryAllocation m_vertexBufferMemory;
+    VkBuffer m_indexBuffer = VK_NULL_HANDLE;
+    MemoryAllocation m_indexBufferMemory;
+
+    // the buffers are host visible device local memory written in place
+    bool m_directUpload = false;
+    // queue families sharing the buffers, empty for exclusive buffers of the graphics queue
+    std::vector<uint32_t> m_concurrentQueueFamilies;
+
+    // free ranges in units of vertices and indices
+    RangeAllocator m_vertexRanges;
+    RangeAllocator m_indexRanges;
+};
+
+
+#endif //VULKANBASICS_GEOMETRYPOOL_H
@@ -0,0 +1,144 @@
+#include "GpuProfiler.h"
+#include "HostAllocator.h"
+#include <algorithm>
+#include <iomanip>
+#include <stdexcept>
+
+// weight of the latest frame in the moving average
+#define GPU_TIMING_SMOOTHING 0.1
+
+void GpuProfiler::Create(VkDevice &device, VkPhysicalDevice &physicalDevice, uint32_t queueFamilyIndex,
+                         uint32_t regionCount, uint32_t scopeCapacity) {
+    // check the queue family supports timestamps
+    uint32_t queueFamilyCount = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, nullptr);
+    std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+    vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, queueFamilies.data());
+    uint32_t validBits = queueFamilies[queueFamilyIndex].timestampValidBits;
+    m_timestampsUnsupported = validBits == 0;
+    if (validBits == 0 || regionCount == 0 || scopeCapacity == 0) {
+        m_queryPool = VK_NULL_HANDLE;
+        return;
+    }
+    m_timestampMask = validBits >= 64 ? ~0ULL : ((1ULL << validBits) - 1);
+
+    VkPhysicalDeviceProperties properties{};
+    vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+    m_timestampPeriod = properties.limits.timestampPeriod;
+
+    m_regionCount = regionCount;
+    m_scopeCapacity = scopeCapacity;
+    m_regionScopeNames.assign(regionCount, {});
+    m_regionPending.assign(regionCount, false);
+
+    // a begin and an end timestamp for each scope of each region
+    VkQueryPoolCreateInfo queryPoolInfo{};
+    queryPoolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+    queryPoolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+    queryPoolInfo.queryCount = regionCount * scopeCapacity * 2;
+    if (vkCreateQueryPool(device, &queryPoolInfo, HostAllocator::GetCallbacks(), &m_queryPool) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create timestamp query pool!");
+    }
+}
+
+void GpuProfiler::Destroy(VkDevice &device) {
+    if (m_queryPool != VK_NULL_HANDLE) {
+        vkDestroyQueryPool(device, m_queryPool, HostAllocator::GetCallbacks());
+        m_queryPool = VK_NULL_HANDLE;
+    }
+}
+
+void GpuProfiler::CmdResetRegion(VkCommandBuffer commandBuffer, uint32_t region, const std::vector<std::string> &scopeNames) {
+    if (!IsEnabled()) {return;}
+    // usually the same names as the last time, don't copy them every frame
+    if (m_regionScopeNames[region] != scopeNames) {
+        m_regionScopeNames[region] = scopeNames;
+    }
+    m_regionPending[region] = false;
+    vkCmdResetQueryPool(commandBuffer, m_queryPool, FirstQuery(region), m_scopeCapacity * 2);
+}
+
+void GpuProfiler::CmdBeginScope(VkCommandBuffer commandBuffer, uint32_t region, uint32_t scope) const {
+    if (!IsEnabled() || scope >= m_scopeCapacity) {return;}
+    // written once all the previous commands have started
+    vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, m_queryPool, FirstQuery(region) + scope * 2);
+}
+
+void GpuProfiler::CmdEndScope(VkCommandBuffer commandBuffer, uint32_t region, uint32_t scope) const {
+    if (!IsEnabled() || scope >= m_scopeCapacity) {return;}
+    // written once all the previous commands have finished
+    vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, m_queryPool, FirstQuery(region) + scope * 2 + 1);
+}
+
+void GpuProfiler::MarkSubmitted(uint32_t region) {
+    if (!IsEnabled()) {return;}
+    m_regionPending[region] = true;
+}
+
+void GpuProfiler::Resolve(VkDevice &device, uint32_t region) {
+    if (!IsEnabled() || !m_regionPending[region]) {return;}
+    m_regionPending[region] = false;
+
+    const std::vector<std::string>& scopeNames = m_regionScopeNames[region];
+    uint32_t scopeCount = std::min(static_cast<uint32_t>(scopeNames.size()), m_scopeCapacity);
+    if (scopeCount == 0) {return;}
+
+    // (timestamp, availability) for each query
+    std::vector<uint64_t> results(scopeCount * 2 * 2);
+    VkResult result = vkGetQueryPoolResults(device, m_queryPool, FirstQuery(region), scopeCount * 2,
+                                            results.size() * sizeof(uint64_t), results.data(), 2 * sizeof(uint64_t),
+                                            VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+    // VK_NOT_READY only means some of the queries are not available, which is checked below
+    if (result != VK_SUCCESS && result != VK_NOT_READY) {return;}
+
+    // sum the scopes with the same name in this frame
+    std::unordered_map<std::string, double> frameMilliseconds;
+    for (uint32_t scope = 0; scope < scopeCount; scope++) {
+        uint64_t begin = results[scope * 4 + 0];
+        bool beginAvailable = results[scope * 4 + 1] != 0;
+        uint64_t end = results[scope * 4 + 2];
+        bool endAvailable = results[scope * 4 + 3] != 0;
+        if (!beginAvailable || !endAvailable) {continue;}
+        uint64_t ticks = ((end & m_timestampMask) - (begin & m_timestampMask)) & m_timestampMask;
+        frameMilliseconds[scopeNames[scope]] += ticks * m_timestampPeriod / 1.0e6;
+    }
+
+    for (const auto& frameTiming : frameMilliseconds) {
+        auto inserted = m_timings.insert({frameTiming.first, GpuScopeTiming{}});
+        GpuScopeTiming& timing = inserted.first->second;
+        if (inserted.second) {
+            timing.name = frameTiming.first;
+            timing.averageMilliseconds = frameTiming.second;
+            m_timingOrder.push_back(frameTiming.first);
+        } else {
+            timing.averageMilliseconds += GPU_TIMING_SMOOTHING * (frameTiming.second - timing.averageMilliseconds);
+        }
+        timing.lastMilliseconds = frameTiming.second;
+        timing.sampleCount++;
+    }
+}
+
+std::vector<GpuScopeTiming> GpuProfiler::GetTimings() const {
+    std::vector<GpuScopeTiming> timings;
+    timings.reserve(m_timingOrder.size());
+    for (const std::string& name : m_timingOrder) {
+        timings.push_back(m_timings.at(name));
+    }
+    return timings;
+}
+
+void GpuProfiler::PrintReport(std::ostream &out) const {
+    if (!IsEnabled()) {
+        out << (m_timestampsUnsupported ? "GPU timestamps are not supported by the graphics queue" : "GPU profiler disabled") << std::endl;
+        return;
+    }
+    out << "GPU timings (ms):" << std::endl;
+    out << std::left << std::setw(24) << "scope" << std::right << std::setw(10) << "last" << std::setw(10) << "average"
+        << std::setw(10) << "frames" << std::endl;
+    out << std::fixed << std::setprecision(3);
+    for (const GpuScopeTiming& timing : GetTimings()) {
+        out << std::left << std::setw(24) << timing.name << std::right << std::setw(10) << timing.lastMilliseconds
+            << std::setw(10) << timing.averageMilliseconds << std::setw(10) << timing.sampleCount << std::endl;
+    }
+    out << std::defaultfloat;
+}
@@ -0,0 +1,73 @@
+#ifndef VULKANBASICS_GPUPROFILER_H
+#define VULKANBASICS_GPUPROFILER_H
+#include <vulkan/vulkan.h>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// GPU time of a scope (render pass or an object draw)
+struct GpuScopeTiming {
+    std::string name;
+    // time of the latest resolved frame
+    double lastMilliseconds = 0.0;
+    // exponential moving average over the resolved frames
+    double averageMilliseconds = 0.0;
+    uint64_t sampleCount = 0;
+};
+
+// Measures GPU time with timestamp queries.
+// The query pool is split into regions, one for each command buffer that is recorded with timestamps,
+// and each region holds a begin/end timestamp pair for every scope. The results of a region are read
+// without waiting (no VK_QUERY_RESULT_WAIT_BIT) after the submission of its command buffer has been waited for,
+// which happens some frames after the timestamps are written.
+class GpuProfiler {
+public:
+    // timestamps are disabled if the queue family doesn't support them
+    void Create(VkDevice& device, VkPhysicalDevice& physicalDevice, uint32_t queueFamilyIndex, uint32_t regionCount, uint32_t scopeCapacity);
+    void Destroy(VkDevice& device);
+
+    inline bool IsEnabled() const {return m_queryPool != VK_NULL_HANDLE;}
+    inline uint32_t GetScopeCapacity() const {return m_scopeCapacity;}
+
+    // reset the queries of a region (must be recorded outside of a render pass) and set the names of its scopes
+    void CmdResetRegion(VkCommandBuffer commandBuffer, uint32_t region, const std::vector<std::string>& scopeNames);
+    // write the begin/end timestamps of a scope, scopes beyond the capacity are not measured
+    void CmdBeginScope(VkCommandBuffer commandBuffer, uint32_t region, uint32_t scope) const;
+    void CmdEndScope(VkCommandBuffer commandBuffer, uint32_t region, uint32_t scope) const;
+
+    // the command buffer of the region has been submitted
+    void MarkSubmitted(uint32_t region);
+    // read the timestamps of a submitted region whose command buffer has finished, never blocks
+    void Resolve(VkDevice& device, uint32_t region);
+
+    // timings keyed by scope name, scopes with the same name are summed up
+    std::vector<GpuScopeTiming> GetTimings() const;
+    void PrintReport(std::ostream& out) const;
+
+private:
+    inline uint32_t FirstQuery(uint32_t region) const {return region * m_scopeCapacity * 2;}
+
+private:
+    VkQueryPool m_queryPool = VK_NULL_HANDLE;
+    // why the profiler is disabled: the queue family has no timestamps, otherwise it was never created (turned off)
+    bool m_timestampsUnsupported = false;
+    uint32_t m_regionCount = 0;
+    uint32_t m_scopeCapacity = 0;
+    // nanoseconds per timestamp tick
+    double m_timestampPeriod = 1.0;
+    // mask of the valid bits of the timestamps
+    uint64_t m_timestampMask = ~0ULL;
+
+    // scope names of each region, as recorded in its command buffer
+    std::vector<std::vector<std::string>> m_regionScopeNames;
+    // whether the region has been submitted and not resolved yet
+    std::vector<bool> m_regionPending;
+
+    std::unordered_map<std::string, GpuScopeTiming> m_timings;
+    // names in first recorded order, for printing
+    std::vector<std::string> m_timingOrder;
+};
+
+
+#endif //VULKANBASICS_GPUPROFILER_H
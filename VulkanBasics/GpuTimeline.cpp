@@ -0,0 +1,176 @@
+#include "GpuTimeline.h"
+#include "HostAllocator.h"
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+
+bool GpuTimeline::IsTimelineSemaphoreSupported(VkInstance &instance, VkPhysicalDevice &physicalDevice, uint32_t instanceApiVersion) {
+    VkPhysicalDeviceProperties properties{};
+    vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+    if (instanceApiVersion < VK_API_VERSION_1_2 || properties.apiVersion < VK_API_VERSION_1_2) {
+        return false;
+    }
+    // loaded at runtime, so that the application still links against a 1.0 loader
+    auto getFeatures2 = (PFN_vkGetPhysicalDeviceFeatures2) vkGetInstanceProcAddr(instance, "vkGetPhysicalDeviceFeatures2");
+    if (getFeatures2 == nullptr) {
+        return false;
+    }
+    VkPhysicalDeviceTimelineSemaphoreFeatures timelineFeatures{};
+    timelineFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES;
+    VkPhysicalDeviceFeatures2 features{};
+    features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+    features.pNext = &timelineFeatures;
+    getFeatures2(physicalDevice, &features);
+    return timelineFeatures.timelineSemaphore == VK_TRUE;
+}
+
+void GpuTimeline::Create(VkDevice &device, bool useTimelineSemaphore) {
+    m_lastSubmittedValue = 0;
+    m_completedValue = 0;
+    if (!useTimelineSemaphore) {
+        m_semaphore = VK_NULL_HANDLE;
+        return;
+    }
+    m_getSemaphoreCounterValue = (PFN_vkGetSemaphoreCounterValue) vkGetDeviceProcAddr(device, "vkGetSemaphoreCounterValue");
+    m_waitSemaphores = (PFN_vkWaitSemaphores) vkGetDeviceProcAddr(device, "vkWaitSemaphores");
+    if (m_getSemaphoreCounterValue == nullptr || m_waitSemaphores == nullptr) {
+        throw std::runtime_error("Failed to load the timeline semaphore functions!");
+    }
+
+    VkSemaphoreTypeCreateInfo typeInfo{};
+    typeInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+    typeInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+    typeInfo.initialValue = 0;
+    VkSemaphoreCreateInfo semaphoreInfo{};
+    semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+    semaphoreInfo.pNext = &typeInfo;
+    if (vkCreateSemaphore(device, &semaphoreInfo, HostAllocator::GetCallbacks(), &m_semaphore) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create timeline semaphore!");
+    }
+}
+
+void GpuTimeline::Destroy(VkDevice &device) {
+    if (m_semaphore != VK_NULL_HANDLE) {
+        vkDestroySemaphore(device, m_semaphore, HostAllocator::GetCallbacks());
+        m_semaphore = VK_NULL_HANDLE;
+    }
+    for (auto& pendingFence : m_pendingFences) {
+        vkDestroyFence(device, pendingFence.second, HostAllocator::GetCallbacks());
+    }
+    m_pendingFences.clear();
+    for (VkFence fence : m_freeFences) {
+        vkDestroyFence(device, fence, HostAllocator::GetCallbacks());
+    }
+    m_freeFences.clear();
+}
+
+uint64_t GpuTimeline::Submit(VkDevice &device, VkQueue queue, const VkSubmitInfo &submitInfo, const uint64_t* waitSemaphoreValues) {
+    uint64_t value = m_lastSubmittedValue + 1;
+
+    if (UsesTimelineSemaphore()) {
+        // append the timeline semaphore to the signal semaphores, the values of binary semaphores are ignored
+        std::vector<VkSemaphore> signalSemaphores(submitInfo.pSignalSemaphores, submitInfo.pSignalSemaphores + submitInfo.signalSemaphoreCount);
+        signalSemaphores.push_back(m_semaphore);
+        std::vector<uint64_t> signalValues(signalSemaphores.size(), 0);
+        signalValues.back() = value;
+        std::vector<uint64_t> waitValues(submitInfo.waitSemaphoreCount, 0);
+        if (waitSemaphoreValues) {
+            waitValues.assign(waitSemaphoreValues, waitSemaphoreValues + submitInfo.waitSemaphoreCount);
+        }
+
+        VkTimelineSemaphoreSubmitInfo timelineInfo{};
+        timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+        timelineInfo.pNext = submitInfo.pNext;
+        timelineInfo.waitSemaphoreValueCount = static_cast<uint32_t>(waitValues.size());
+        timelineInfo.pWaitSemaphoreValues = waitValues.data();
+        timelineInfo.signalSemaphoreValueCount = static_cast<uint32_t>(signalValues.size());
+        timelineInfo.pSignalSemaphoreValues = signalValues.data();
+
+        VkSubmitInfo timelineSubmitInfo = submitInfo;
+        timelineSubmitInfo.pNext = &timelineInfo;
+        timelineSubmitInfo.signalSemaphoreCount = static_cast<uint32_t>(signalSemaphores.size());
+        timelineSubmitInfo.pSignalSemaphores = signalSemaphores.data();
+        if (vkQueueSubmit(queue, 1, &timelineSubmitInfo, VK_NULL_HANDLE) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to submit command buffer!");
+        }
+    } else {
+        VkFence fence = AcquireFence(device);
+        if (vkQueueSubmit(queue, 1, &submitInfo, fence) != VK_SUCCESS) {
+            m_freeFences.push_back(fence);
+            throw std::runtime_error("Failed to submit command buffer!");
+        }
+        m_pendingFences.emplace_back(value, fence);
+    }
+
+    m_lastSubmittedValue = value;
+    return value;
+}
+
+uint64_t GpuTimeline::GetCompletedValue(VkDevice &device) {
+    if (UsesTimelineSemaphore()) {
+        uint64_t value = 0;
+        if (m_getSemaphoreCounterValue(device, m_semaphore, &value) == VK_SUCCESS) {
+            m_completedValue = std::max(m_completedValue, value);
+        }
+    } else {
+        RecycleSignaledFences(device);
+    }
+    return m_completedValue;
+}
+
+void GpuTimeline::Wait(VkDevice &device, uint64_t value) {
+    if (value == 0 || value <= m_completedValue) {return;}
+    if (value > m_lastSubmittedValue) {
+        throw std::runtime_error("Failed to wait for a timeline value that has not been submitted!");
+    }
+
+    if (UsesTimelineSemaphore()) {
+        VkSemaphoreWaitInfo waitInfo{};
+        waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+        waitInfo.semaphoreCount = 1;
+        waitInfo.pSemaphores = &m_semaphore;
+        waitInfo.pValues = &value;
+        if (m_waitSemaphores(device, &waitInfo, std::numeric_limits<uint64_t>::max()) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to wait for timeline semaphore!");
+        }
+        m_completedValue = std::max(m_completedValue, value);
+    } else {
+        // the fence of the submission that signals the value
+        for (auto& pendingFence : m_pendingFences) {
+            if (pendingFence.first >= value) {
+                vkWaitForFences(device, 1, &pendingFence.second, VK_TRUE, std::numeric_limits<uint64_t>::max());
+                break;
+            }
+        }
+        RecycleSignaledFences(device);
+        // submissions to one queue finish in order
+        m_completedValue = std::max(m_completedValue, value);
+    }
+}
+
+VkFence GpuTimeline::AcquireFence(VkDevice &device) {
+    if (m_freeFences.empty()) {
+        RecycleSignaledFences(device);
+    }
+    if (!m_freeFences.empty()) {
+        VkFence fence = m_freeFences.back();
+        m_freeFences.pop_back();
+        vkResetFences(device, 1, &fence);
+        return fence;
+    }
+    VkFenceCreateInfo fenceInfo{};
+    fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+    VkFence fence;
+    if (vkCreateFence(device, &fenceInfo, HostAllocator::GetCallbacks(), &fence) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create fence!");
+    }
+    return fence;
+}
+
+void GpuTimeline::RecycleSignaledFences(VkDevice &device) {
+    while (!m_pendingFences.empty() && vkGetFenceStatus(device, m_pendingFences.front().second) == VK_SUCCESS) {
+        m_completedValue = std::max(m_completedValue, m_pendingFences.front().first);
+        m_freeFences.push_back(m_pendingFences.front().second);
+        m_pendingFences.pop_front();
+    }
+}
@@ -0,0 +1,62 @@
+#ifndef VULKANBASICS_GPUTIMELINE_H
+#define VULKANBASICS_GPUTIMELINE_H
+#include <vulkan/vulkan.h>
+#include <cstdint>
+#include <deque>
+#include <utility>
+#include <vector>
+
+// Progress of the submissions to one queue as a monotonically increasing value.
+// Every Submit() signals the next value, CPU code waits for exactly the value it depends on
+// (e.g. the frame that last read a uniform buffer) instead of waiting for the whole queue or device.
+// Uses a timeline semaphore (Vulkan 1.2) when the device supports it, otherwise a fence for each
+// submission that is recycled once signaled.
+class GpuTimeline {
+public:
+    // check the physical device supports timeline semaphores, vkGetPhysicalDeviceFeatures2 needs a 1.1 instance
+    static bool IsTimelineSemaphoreSupported(VkInstance& instance, VkPhysicalDevice& physicalDevice, uint32_t instanceApiVersion);
+
+    // the timelineSemaphore feature must have been enabled on the device to use the timeline semaphore
+    void Create(VkDevice& device, bool useTimelineSemaphore);
+    void Destroy(VkDevice& device);
+
+    inline bool UsesTimelineSemaphore() const {return m_semaphore != VK_NULL_HANDLE;}
+    // the timeline semaphore, other queues can wait for a value of it (VK_NULL_HANDLE with fences)
+    inline VkSemaphore GetSemaphore() const {return m_semaphore;}
+
+    // submit to the queue, also signaling the next value, which is returned
+    // waitSemaphoreValues: one value for each wait semaphore if some of them are timeline semaphores (ignored for binary ones)
+    uint64_t Submit(VkDevice& device, VkQueue queue, const VkSubmitInfo& submitInfo, const uint64_t* waitSemaphoreValues = nullptr);
+
+    // value of the latest submission (0 if nothing has been submitted)
+    inline uint64_t GetLastSubmittedValue() const {return m_lastSubmittedValue;}
+    // the latest value whose submission has finished on the GPU, never blocks
+    uint64_t GetCompletedValue(VkDevice& device);
+    inline bool IsCompleted(VkDevice& device, uint64_t value) {return value <= m_completedValue || value <= GetCompletedValue(device);}
+
+    // block until the submission of the value (and all before it) has finished
+    void Wait(VkDevice& device, uint64_t value);
+    // wait for everything submitted through this timeline
+    inline void WaitIdle(VkDevice& device) {Wait(device, m_lastSubmittedValue);}
+
+private:
+    // fences of the fence fallback
+    VkFence AcquireFence(VkDevice& device);
+    void RecycleSignaledFences(VkDevice& device);
+
+private:
+    VkSemaphore m_semaphore = VK_NULL_HANDLE;
+    PFN_vkGetSemaphoreCounterValue m_getSemaphoreCounterValue = nullptr;
+    PFN_vkWaitSemaphores m_waitSemaphores = nullptr;
+
+    uint64_t m_lastSubmittedValue = 0;
+    // cached, only grows
+    uint64_t m_completedValue = 0;
+
+    // fallback: (value, fence) of the unfinished submissions in submission order, and the reset fences
+    std::deque<std::pair<uint64_t, VkFence>> m_pendingFences;
+    std::vector<VkFence> m_freeFences;
+};
+
+
+#endif //VULKANBASICS_GPUTIMELINE_H
@@ -0,0 +1,281 @@
+#include "HostAllocator.h"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+
+// chunks the pool slots are carved from
+#define HOST_POOL_CHUNK_SIZE (64 * 1024)
+// slot sizes are powers of two from 64 to 4096 bytes (header included), bigger allocations use the heap
+#define HOST_POOL_MIN_SLOT_SIZE 64
+#define HOST_POOL_SIZE_CLASS_COUNT 7
+// slots are aligned to their chunk's 64 bytes alignment
+#define HOST_POOL_MAX_ALIGNMENT 64
+// space reserved in front of every allocation for its header (more if the alignment is bigger)
+#define HOST_ALLOCATION_HEADER_SPACE 32
+#define HOST_ALLOCATION_NOT_POOLED 0xFFFF
+
+// stored right in front of the memory returned to the driver
+struct HostAllocationHeader {
+    // requested size
+    size_t size;
+    // distance from the start of the slot or heap block to the returned memory
+    uint32_t offset;
+    // size class of the slot, HOST_ALLOCATION_NOT_POOLED for heap blocks
+    uint16_t sizeClass;
+    uint16_t scope;
+};
+
+static inline HostAllocationHeader* GetHeader(void* memory) {
+    return reinterpret_cast<HostAllocationHeader*>(static_cast<char*>(memory) - sizeof(HostAllocationHeader));
+}
+
+static inline size_t GetSlotSize(uint32_t sizeClass) {
+    return static_cast<size_t>(HOST_POOL_MIN_SLOT_SIZE) << sizeClass;
+}
+
+HostAllocator* HostAllocator::s_activeAllocator = nullptr;
+
+HostAllocator::HostAllocator() = default;
+
+HostAllocator::~HostAllocator() {
+    if (s_activeAllocator == this) {
+        s_activeAllocator = nullptr;
+    }
+    // the driver still owns the slots of leaked allocations, so the chunks are only freed if there are none
+    uint64_t liveCount = 0;
+    for (const HostAllocationScopeStatistics& scope : m_statistics.scopes) {
+        liveCount += scope.allocationCount;
+    }
+    if (liveCount == 0) {
+        for (void* chunk : m_chunks) {
+            free(chunk);
+        }
+    }
+}
+
+void HostAllocator::Create() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_callbacks.pUserData = this;
+    m_callbacks.pfnAllocation = &HostAllocator::Allocation;
+    m_callbacks.pfnReallocation = &HostAllocator::Reallocation;
+    m_callbacks.pfnFree = &HostAllocator::Free;
+    m_callbacks.pfnInternalAllocation = &HostAllocator::InternalAllocation;
+    m_callbacks.pfnInternalFree = &HostAllocator::InternalFree;
+    m_freeSlots.assign(HOST_POOL_SIZE_CLASS_COUNT, std::vector<void*>());
+    m_statistics = HostAllocatorStatistics();
+    s_activeAllocator = this;
+}
+
+void HostAllocator::Destroy() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (s_activeAllocator == this) {
+        s_activeAllocator = nullptr;
+    }
+    uint64_t liveCount = 0;
+    for (size_t i = 0; i < m_statistics.scopes.size(); i++) {
+        const HostAllocationScopeStatistics& scope = m_statistics.scopes[i];
+        if (scope.allocationCount == 0) {continue;}
+        liveCount += scope.allocationCount;
+        std::cerr << scope.allocationCount << " host allocations (" << scope.bytes << " bytes) of the "
+                  << GetScopeName(static_cast<VkSystemAllocationScope>(i)) << " scope were not freed by the driver" << std::endl;
+    }
+    if (liveCount > 0) {return;}
+    for (void* chunk : m_chunks) {
+        free(chunk);
+    }
+    m_chunks.clear();
+    m_freeSlots.clear();
+    m_statistics.chunkCount = 0;
+    m_statistics.chunkBytes = 0;
+}
+
+const VkAllocationCallbacks *HostAllocator::GetCallbacks() {
+    return s_activeAllocator ? &s_activeAllocator->m_callbacks : nullptr;
+}
+
+const char *HostAllocator::GetScopeName(VkSystemAllocationScope scope) {
+    switch (scope) {
+        case VK_SYSTEM_ALLOCATION_SCOPE_COMMAND: return "command";
+        case VK_SYSTEM_ALLOCATION_SCOPE_OBJECT: return "object";
+        case VK_SYSTEM_ALLOCATION_SCOPE_CACHE: return "cache";
+        case VK_SYSTEM_ALLOCATION_SCOPE_DEVICE: return "device";
+        case VK_SYSTEM_ALLOCATION_SCOPE_INSTANCE: return "instance";
+        default: break;
+    }
+    return "unknown";
+}
+
+HostAllocatorStatistics HostAllocator::GetStatistics() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_statistics;
+}
+
+uint64_t HostAllocator::GetCallCount() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    uint64_t callCount = 0;
+    for (const HostAllocationScopeStatistics& scope : m_statistics.scopes) {
+        callCount += scope.callCount;
+    }
+    return callCount;
+}
+
+void HostAllocator::PrintStatistics(std::ostream &out) const {
+    HostAllocatorStatistics statistics = GetStatistics();
+    const double kilobyte = 1024.0;
+    uint64_t callCount = 0;
+    out << "Vulkan host memory:" << std::endl;
+    out << std::fixed << std::setprecision(1);
+    for (size_t i = 0; i < statistics.scopes.size(); i++) {
+        const HostAllocationScopeStatistics& scope = statistics.scopes[i];
+        callCount += scope.callCount;
+        out << "  " << std::setw(8) << GetScopeName(static_cast<VkSystemAllocationScope>(i)) << ": " << scope.callCount << " calls, "
+            << scope.allocationCount << " live (" << scope.bytes / kilobyte << " KB, peak " << scope.peakBytes / kilobyte << " KB)";
+        if (scope.internalBytes > 0) {
+            out << ", internal " << scope.internalBytes / kilobyte << " KB";
+        }
+        out << std::endl;
+    }
+    out << "  " << statistics.pooledCallCount << " of " << callCount << " calls served from " << statistics.chunkCount
+        << " pool chunks (" << statistics.chunkBytes / kilobyte << " KB)" << std::endl;
+    out << std::defaultfloat;
+}
+
+VKAPI_ATTR void* VKAPI_CALL HostAllocator::Allocation(void *userData, size_t size, size_t alignment, VkSystemAllocationScope scope) {
+    HostAllocator* allocator = static_cast<HostAllocator*>(userData);
+    std::lock_guard<std::mutex> lock(allocator->m_mutex);
+    return allocator->AllocateLocked(size, alignment, scope);
+}
+
+VKAPI_ATTR void* VKAPI_CALL HostAllocator::Reallocation(void *userData, void *original, size_t size, size_t alignment,
+                                                         VkSystemAllocationScope scope) {
+    HostAllocator* allocator = static_cast<HostAllocator*>(userData);
+    std::lock_guard<std::mutex> lock(allocator->m_mutex);
+    if (original == nullptr) {
+        return allocator->AllocateLocked(size, alignment, scope);
+    }
+    if (size == 0) {
+        allocator->FreeLocked(original);
+        return nullptr;
+    }
+    HostAllocationHeader* header = GetHeader(original);
+    // the slot may already be big enough
+    if (header->sizeClass != HOST_ALLOCATION_NOT_POOLED && header->offset + size <= GetSlotSize(header->sizeClass)) {
+        HostAllocationScopeStatistics& statistics = allocator->m_statistics.scopes[header->scope];
+        statistics.bytes = statistics.bytes - header->size + size;
+        statistics.peakBytes = std::max(statistics.peakBytes, statistics.bytes);
+        statistics.callCount++;
+        header->size = size;
+        return original;
+    }
+    void* memory = allocator->AllocateLocked(size, alignment, scope);
+    if (memory == nullptr) {
+        // the original allocation stays valid
+        return nullptr;
+    }
+    memcpy(memory, original, std::min(size, header->size));
+    allocator->FreeLocked(original);
+    return memory;
+}
+
+VKAPI_ATTR void VKAPI_CALL HostAllocator::Free(void *userData, void *memory) {
+    HostAllocator* allocator = static_cast<HostAllocator*>(userData);
+    std::lock_guard<std::mutex> lock(allocator->m_mutex);
+    allocator->FreeLocked(memory);
+}
+
+VKAPI_ATTR void VKAPI_CALL HostAllocator::InternalAllocation(void *userData, size_t size, VkInternalAllocationType,
+                                                             VkSystemAllocationScope scope) {
+    HostAllocator* allocator = static_cast<HostAllocator*>(userData);
+    std::lock_guard<std::mutex> lock(allocator->m_mutex);
+    if (scope < HOST_ALLOCATION_SCOPE_COUNT) {
+        allocator->m_statistics.scopes[scope].internalBytes += size;
+    }
+}
+
+VKAPI_ATTR void VKAPI_CALL HostAllocator::InternalFree(void *userData, size_t size, VkInternalAllocationType,
+                                                       VkSystemAllocationScope scope) {
+    HostAllocator* allocator = static_cast<HostAllocator*>(userData);
+    std::lock_guard<std::mutex> lock(allocator->m_mutex);
+    if (scope < HOST_ALLOCATION_SCOPE_COUNT) {
+        allocator->m_statistics.scopes[scope].internalBytes -= size;
+    }
+}
+
+void *HostAllocator::AllocateLocked(size_t size, size_t alignment, VkSystemAllocationScope scope) {
+    if (size == 0 || scope >= HOST_ALLOCATION_SCOPE_COUNT) {return nullptr;}
+    alignment = std::max<size_t>(alignment, 1);
+    // the header fits in front of the memory, which keeps the alignment
+    size_t headerSpace = std::max<size_t>(alignment, HOST_ALLOCATION_HEADER_SPACE);
+
+    char* memory = nullptr;
+    HostAllocationHeader header{};
+    header.size = size;
+    header.scope = static_cast<uint16_t>(scope);
+    header.sizeClass = HOST_ALLOCATION_NOT_POOLED;
+    bool poolable = (scope == VK_SYSTEM_ALLOCATION_SCOPE_COMMAND || scope == VK_SYSTEM_ALLOCATION_SCOPE_OBJECT) &&
+                    alignment <= HOST_POOL_MAX_ALIGNMENT;
+    uint32_t sizeClass = 0;
+    while (sizeClass < HOST_POOL_SIZE_CLASS_COUNT && GetSlotSize(sizeClass) < headerSpace + size) {
+        sizeClass++;
+    }
+    if (poolable && sizeClass < HOST_POOL_SIZE_CLASS_COUNT) {
+        char* slot = static_cast<char*>(AllocateSlot(sizeClass));
+        if (slot == nullptr) {return nullptr;}
+        memory = slot + headerSpace;
+        header.sizeClass = static_cast<uint16_t>(sizeClass);
+        header.offset = static_cast<uint32_t>(headerSpace);
+        m_statistics.pooledCallCount++;
+    } else {
+        char* block = static_cast<char*>(malloc(headerSpace + size + alignment));
+        if (block == nullptr) {return nullptr;}
+        uintptr_t address = reinterpret_cast<uintptr_t>(block) + headerSpace;
+        memory = reinterpret_cast<char*>((address + alignment - 1) & ~(static_cast<uintptr_t>(alignment) - 1));
+        header.offset = static_cast<uint32_t>(memory - block);
+    }
+    *GetHeader(memory) = header;
+
+    HostAllocationScopeStatistics& statistics = m_statistics.scopes[scope];
+    statistics.allocationCount++;
+    statistics.callCount++;
+    statistics.bytes += size;
+    statistics.peakBytes = std::max(statistics.peakBytes, statistics.bytes);
+    return memory;
+}
+
+void HostAllocator::FreeLocked(void *memory) {
+    if (memory == nullptr) {return;}
+    HostAllocationHeader header = *GetHeader(memory);
+    HostAllocationScopeStatistics& statistics = m_statistics.scopes[header.scope];
+    statistics.allocationCount--;
+    statistics.bytes -= header.size;
+    char* start = static_cast<char*>(memory) - header.offset;
+    if (header.sizeClass == HOST_ALLOCATION_NOT_POOLED) {
+        free(start);
+    } else {
+        m_freeSlots[header.sizeClass].push_back(start);
+    }
+}
+
+void *HostAllocator::AllocateSlot(uint32_t sizeClass) {
+    std::vector<void*>& freeSlots = m_freeSlots[sizeClass];
+    if (freeSlots.empty()) {
+        // over-allocate so that the slots start at the pool alignment
+        char* chunk = static_cast<char*>(malloc(HOST_POOL_CHUNK_SIZE + HOST_POOL_MAX_ALIGNMENT));
+        if (chunk == nullptr) {return nullptr;}
+        m_chunks.push_back(chunk);
+        m_statistics.chunkCount++;
+        m_statistics.chunkBytes += HOST_POOL_CHUNK_SIZE + HOST_POOL_MAX_ALIGNMENT;
+        uintptr_t address = reinterpret_cast<uintptr_t>(chunk);
+        char* first = reinterpret_cast<char*>((address + HOST_POOL_MAX_ALIGNMENT - 1) & ~(static_cast<uintptr_t>(HOST_POOL_MAX_ALIGNMENT) - 1));
+        size_t slotSize = GetSlotSize(sizeClass);
+        // pushed backwards, so the slots are handed out in address order
+        for (size_t offset = HOST_POOL_CHUNK_SIZE / slotSize; offset > 0; offset--) {
+            freeSlots.push_back(first + (offset - 1) * slotSize);
+        }
+    }
+    void* slot = freeSlots.back();
+    freeSlots.pop_back();
+    return slot;
+}
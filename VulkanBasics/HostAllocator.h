@@ -0,0 +1,87 @@
+#ifndef VULKANBASICS_HOSTALLOCATOR_H
+#define VULKANBASICS_HOSTALLOCATOR_H
+#include <vulkan/vulkan.h>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+#include <vector>
+
+// number of VkSystemAllocationScope values (COMMAND, OBJECT, CACHE, DEVICE, INSTANCE)
+#define HOST_ALLOCATION_SCOPE_COUNT 5
+
+// host memory the driver allocated for one allocation scope
+struct HostAllocationScopeStatistics {
+    // live allocations and their bytes
+    uint64_t allocationCount = 0;
+    size_t bytes = 0;
+    // high-water mark of bytes since Create()
+    size_t peakBytes = 0;
+    // allocation and reallocation calls since Create()
+    uint64_t callCount = 0;
+    // memory the driver allocated itself and reported (e.g. executable memory)
+    size_t internalBytes = 0;
+};
+
+struct HostAllocatorStatistics {
+    std::array<HostAllocationScopeStatistics, HOST_ALLOCATION_SCOPE_COUNT> scopes;
+    // allocations served from the pools since Create(), and the memory of the pool chunks
+    uint64_t pooledCallCount = 0;
+    uint64_t chunkCount = 0;
+    size_t chunkBytes = 0;
+};
+
+// VkAllocationCallbacks counting the host allocations of the driver by VkSystemAllocationScope.
+// The short-lived COMMAND scope and the OBJECT scope allocations (small and frequent) are served from
+// pools of power of two size classes carved out of large chunks, the other scopes use the heap.
+// Opt-in: Create() makes the allocator active and GetCallbacks() returns its callbacks, which every vkCreate*,
+// vkDestroy*, vkAllocateMemory and vkFreeMemory passes, so the same callbacks create and destroy each object.
+class HostAllocator {
+public:
+    HostAllocator();
+    ~HostAllocator();
+
+    // become the active allocator
+    void Create();
+    // stop being the active allocator, all the Vulkan objects must have been destroyed
+    void Destroy();
+
+    // callbacks of the active allocator, nullptr (the driver's allocator) if none is active
+    static const VkAllocationCallbacks* GetCallbacks();
+    static const char* GetScopeName(VkSystemAllocationScope scope);
+
+    HostAllocatorStatistics GetStatistics() const;
+    // allocation calls of all the scopes since Create(), to measure the calls of a code path
+    uint64_t GetCallCount() const;
+    void PrintStatistics(std::ostream& out) const;
+
+private:
+    static VKAPI_ATTR void* VKAPI_CALL Allocation(void* userData, size_t size, size_t alignment, VkSystemAllocationScope scope);
+    static VKAPI_ATTR void* VKAPI_CALL Reallocation(void* userData, void* original, size_t size, size_t alignment, VkSystemAllocationScope scope);
+    static VKAPI_ATTR void VKAPI_CALL Free(void* userData, void* memory);
+    static VKAPI_ATTR void VKAPI_CALL InternalAllocation(void* userData, size_t size, VkInternalAllocationType type, VkSystemAllocationScope scope);
+    static VKAPI_ATTR void VKAPI_CALL InternalFree(void* userData, size_t size, VkInternalAllocationType type, VkSystemAllocationScope scope);
+
+    // m_mutex must be locked
+    void* AllocateLocked(size_t size, size_t alignment, VkSystemAllocationScope scope);
+    void FreeLocked(void* memory);
+    // take a slot of the size class, adding a chunk if its free list is empty
+    void* AllocateSlot(uint32_t sizeClass);
+
+private:
+    VkAllocationCallbacks m_callbacks{};
+
+    // free slots of each size class, and the chunks they are carved from
+    std::vector<std::vector<void*>> m_freeSlots;
+    std::vector<void*> m_chunks;
+
+    HostAllocatorStatistics m_statistics;
+    // the driver allocates from several threads
+    mutable std::mutex m_mutex;
+
+    static HostAllocator* s_activeAllocator;
+};
+
+
+#endif //VULKANBASICS_HOSTALLOCATOR_H
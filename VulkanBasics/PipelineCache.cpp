@@ -0,0 +1,168 @@
+#include "PipelineCache.h"
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include "HostAllocator.h"
+
+// "VKPC", identifies the files written by SaveCacheData
+#define PIPELINE_CACHE_FILE_MAGIC 0x43504b56u
+#define PIPELINE_CACHE_FILE_VERSION 1u
+// headerSize, headerVersion, vendorID and deviceID, followed by the pipeline cache UUID
+#define PIPELINE_CACHE_HEADER_SIZE (4 * sizeof(uint32_t) + VK_UUID_SIZE)
+
+// written before the cache data, to recognize files of other versions and truncated or corrupted data
+struct PipelineCacheFileHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t dataSize;
+    uint64_t checksum;
+};
+
+// FNV-1a, drivers don't validate the cache data beyond its header
+static uint64_t Checksum(const char* data, size_t size) {
+    uint64_t hash = 14695981039346656037ull;
+    for (size_t i = 0; i < size; i++) {
+        hash ^= static_cast<uint8_t>(data[i]);
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+void PipelineCache::Create(VkDevice &device, VkPhysicalDevice &physicalDevice, const char *fileName) {
+    m_fileName = fileName ? fileName : "";
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+    m_vendorID = properties.vendorID;
+    m_deviceID = properties.deviceID;
+    memcpy(m_pipelineCacheUUID, properties.pipelineCacheUUID, VK_UUID_SIZE);
+
+    std::vector<char> cacheData = LoadCacheData();
+    m_statistics = PipelineCacheStatistics();
+    m_statistics.loaded = !cacheData.empty();
+    m_statistics.loadedBytes = cacheData.size();
+
+    VkPipelineCacheCreateInfo cacheInfo{};
+    cacheInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+    cacheInfo.initialDataSize = cacheData.size();
+    cacheInfo.pInitialData = cacheData.empty() ? nullptr : cacheData.data();
+    if (vkCreatePipelineCache(device, &cacheInfo, HostAllocator::GetCallbacks(), &m_cache) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create pipeline cache!");
+    }
+}
+
+void PipelineCache::Destroy(VkDevice &device) {
+    if (m_cache == VK_NULL_HANDLE) {return;}
+    if (!m_fileName.empty()) {
+        // the cache is only an optimisation, failing to save it must not stop the clean up
+        try {
+            SaveCacheData(device);
+        } catch (const std::exception& e) {
+            std::cerr << "Failed to save the pipeline cache: " << e.what() << std::endl;
+            std::remove((m_fileName + ".tmp").c_str());
+        }
+    }
+    vkDestroyPipelineCache(device, m_cache, HostAllocator::GetCallbacks());
+    m_cache = VK_NULL_HANDLE;
+}
+
+void PipelineCache::CreateGraphicsPipelines(VkDevice &device, uint32_t count, const VkGraphicsPipelineCreateInfo *createInfos, VkPipeline *pipelines) {
+    auto startTime = std::chrono::high_resolution_clock::now();
+    if (vkCreateGraphicsPipelines(device, m_cache, count, createInfos, HostAllocator::GetCallbacks(), pipelines) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create graphics pipeline!");
+    }
+    auto endTime = std::chrono::high_resolution_clock::now();
+    std::lock_guard<std::mutex> lock(m_statisticsMutex);
+    m_statistics.pipelineCount += count;
+    m_statistics.creationTime += std::chrono::duration<double, std::milli>(endTime - startTime).count();
+}
+
+PipelineCacheStatistics PipelineCache::GetStatistics() const {
+    std::lock_guard<std::mutex> lock(m_statisticsMutex);
+    return m_statistics;
+}
+
+void PipelineCache::PrintStatistics(std::ostream &out) const {
+    PipelineCacheStatistics statistics = GetStatistics();
+    out << "Pipeline cache: " << (statistics.loaded ? "warm (" : "cold (") << statistics.loadedBytes << " bytes loaded), "
+        << statistics.pipelineCount << " pipelines created in " << statistics.creationTime << " ms" << std::endl;
+}
+
+std::vector<char> PipelineCache::LoadCacheData() const {
+    if (m_fileName.empty()) {return {};}
+    std::ifstream file(m_fileName, std::ios::ate | std::ios::binary);
+    // first run, nothing cached yet
+    if (!file.is_open()) {return {};}
+    size_t fileSize = (size_t) file.tellg();
+    file.seekg(0);
+
+    PipelineCacheFileHeader fileHeader{};
+    if (fileSize < sizeof(fileHeader) || !file.read(reinterpret_cast<char*>(&fileHeader), sizeof(fileHeader)) ||
+        fileHeader.magic != PIPELINE_CACHE_FILE_MAGIC || fileHeader.version != PIPELINE_CACHE_FILE_VERSION ||
+        fileHeader.dataSize != fileSize - sizeof(fileHeader)) {
+        return {};
+    }
+    std::vector<char> cacheData(static_cast<size_t>(fileHeader.dataSize));
+    if (!file.read(cacheData.data(), static_cast<std::streamsize>(cacheData.size())) ||
+        Checksum(cacheData.data(), cacheData.size()) != fileHeader.checksum || !IsCompatible(cacheData)) {
+        // truncated, corrupted, or written by another device or driver version: start with an empty cache
+        return {};
+    }
+    return cacheData;
+}
+
+void PipelineCache::SaveCacheData(VkDevice &device) const {
+    size_t dataSize = 0;
+    if (vkGetPipelineCacheData(device, m_cache, &dataSize, nullptr) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to get pipeline cache data!");
+    }
+    std::vector<char> cacheData(dataSize);
+    if (vkGetPipelineCacheData(device, m_cache, &dataSize, cacheData.data()) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to get pipeline cache data!");
+    }
+    cacheData.resize(dataSize);
+
+    PipelineCacheFileHeader fileHeader{};
+    fileHeader.magic = PIPELINE_CACHE_FILE_MAGIC;
+    fileHeader.version = PIPELINE_CACHE_FILE_VERSION;
+    fileHeader.dataSize = cacheData.size();
+    fileHeader.checksum = Checksum(cacheData.data(), cacheData.size());
+
+    // write everything to a temporary file first, the previous cache stays valid until the rename
+    std::string tempFileName = m_fileName + ".tmp";
+    {
+        std::ofstream file(tempFileName, std::ios::binary | std::ios::trunc);
+        if (!file.is_open()) {
+            throw std::runtime_error("Failed to open file: " + tempFileName);
+        }
+        file.write(reinterpret_cast<const char*>(&fileHeader), sizeof(fileHeader));
+        file.write(cacheData.data(), static_cast<std::streamsize>(cacheData.size()));
+        file.flush();
+        if (!file) {
+            file.close();
+            std::remove(tempFileName.c_str());
+            throw std::runtime_error("Failed to write file: " + tempFileName);
+        }
+    }
+    if (std::rename(tempFileName.c_str(), m_fileName.c_str()) != 0) {
+        // rename doesn't replace an existing file on Windows
+        std::remove(m_fileName.c_str());
+        if (std::rename(tempFileName.c_str(), m_fileName.c_str()) != 0) {
+            std::remove(tempFileName.c_str());
+            throw std::runtime_error("Failed to replace file: " + m_fileName);
+        }
+    }
+}
+
+bool PipelineCache::IsCompatible(const std::vector<char> &cacheData) const {
+    if (cacheData.size() < PIPELINE_CACHE_HEADER_SIZE) {return false;}
+    uint32_t header[4];
+    memcpy(header, cacheData.data(), sizeof(header));
+    // headerSize, headerVersion, vendorID, deviceID
+    if (header[0] < PIPELINE_CACHE_HEADER_SIZE || header[0] > cacheData.size()) {return false;}
+    if (header[1] != VK_PIPELINE_CACHE_HEADER_VERSION_ONE) {return false;}
+    if (header[2] != m_vendorID || header[3] != m_deviceID) {return false;}
+    return memcmp(cacheData.data() + sizeof(header), m_pipelineCacheUUID, VK_UUID_SIZE) == 0;
+}
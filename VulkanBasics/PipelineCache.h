@@ -0,0 +1,60 @@
+#ifndef VULKANBASICS_PIPELINECACHE_H
+#define VULKANBASICS_PIPELINECACHE_H
+#include <vulkan/vulkan.h>
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// pipelines created through the cache since Create()
+struct PipelineCacheStatistics {
+    // the cache was filled from the file of a previous run
+    bool loaded = false;
+    size_t loadedBytes = 0;
+    uint32_t pipelineCount = 0;
+    // time spent in vkCreateGraphicsPipelines, summed over the threads creating pipelines (milliseconds)
+    double creationTime = 0.0;
+};
+
+// Process-wide VkPipelineCache persisted across runs.
+// Create() fills it from the file written by the previous run if the header of the data matches this device
+// (vendor and device ID, pipeline cache UUID of the driver) and its checksum is intact, otherwise it starts empty.
+// Destroy() writes the data to a temporary file and renames it over the previous one, so a crash while
+// saving never leaves a truncated cache behind.
+class PipelineCache {
+public:
+    // fileName nullptr: the cache only lives for this run
+    void Create(VkDevice& device, VkPhysicalDevice& physicalDevice, const char* fileName);
+    // save the cache (if it has a file, a failure is reported on stderr) and destroy it, the device must not be creating pipelines
+    void Destroy(VkDevice& device);
+
+    // create the pipelines of the create infos with the cache, measuring the time spent (thread safe)
+    void CreateGraphicsPipelines(VkDevice& device, uint32_t count, const VkGraphicsPipelineCreateInfo* createInfos, VkPipeline* pipelines);
+
+    inline VkPipelineCache GetCache() const {return m_cache;}
+    PipelineCacheStatistics GetStatistics() const;
+    void PrintStatistics(std::ostream& out) const;
+
+private:
+    // the cache data of the file, empty if it is missing or was written for another device or driver
+    std::vector<char> LoadCacheData() const;
+    void SaveCacheData(VkDevice& device) const;
+    // the Vulkan header at the beginning of the cache data matches the physical device
+    bool IsCompatible(const std::vector<char>& cacheData) const;
+
+private:
+    VkPipelineCache m_cache = VK_NULL_HANDLE;
+    std::string m_fileName;
+
+    // identify the driver the cache data is valid for
+    uint32_t m_vendorID = 0;
+    uint32_t m_deviceID = 0;
+    uint8_t m_pipelineCacheUUID[VK_UUID_SIZE] = {};
+
+    PipelineCacheStatistics m_statistics;
+    mutable std::mutex m_statisticsMutex;
+};
+
+
+#endif //VULKANBASICS_PIPELINECACHE_H
@@ -0,0 +1,294 @@
+#include "PipelineRegistry.h"
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <stdexcept>
+#include "HostAllocator.h"
+
+// boost::hash_combine
+static void HashCombine(size_t& seed, size_t value) {
+    seed ^= value + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+}
+
+bool GraphicsPipelineDescription::operator==(const GraphicsPipelineDescription &other) const {
+    if (vertexShader != other.vertexShader || fragmentShader != other.fragmentShader) {return false;}
+    if (vertexBinding.binding != other.vertexBinding.binding || vertexBinding.stride != other.vertexBinding.stride ||
+        vertexBinding.inputRate != other.vertexBinding.inputRate || vertexAttributes.size() != other.vertexAttributes.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < vertexAttributes.size(); i++) {
+        const VkVertexInputAttributeDescription& attribute = vertexAttributes[i];
+        const VkVertexInputAttributeDescription& otherAttribute = other.vertexAttributes[i];
+        if (attribute.location != otherAttribute.location || attribute.binding != otherAttribute.binding ||
+            attribute.format != otherAttribute.format || attribute.offset != otherAttribute.offset) {
+            return false;
+        }
+    }
+    return topology == other.topology && polygonMode == other.polygonMode && cullMode == other.cullMode &&
+           frontFace == other.frontFace && blendEnable == other.blendEnable && renderPass == other.renderPass && subpass == other.subpass;
+}
+
+size_t std::hash<GraphicsPipelineDescription>::operator()(GraphicsPipelineDescription const &description) const {
+    size_t seed = hash<string>()(description.vertexShader);
+    HashCombine(seed, hash<string>()(description.fragmentShader));
+    HashCombine(seed, description.vertexBinding.stride);
+    HashCombine(seed, description.vertexBinding.inputRate);
+    for (const VkVertexInputAttributeDescription& attribute : description.vertexAttributes) {
+        HashCombine(seed, attribute.location);
+        HashCombine(seed, attribute.format);
+        HashCombine(seed, attribute.offset);
+    }
+    HashCombine(seed, description.topology);
+    HashCombine(seed, description.polygonMode);
+    HashCombine(seed, description.cullMode);
+    HashCombine(seed, description.frontFace);
+    HashCombine(seed, description.blendEnable);
+    HashCombine(seed, hash<VkRenderPass>()(description.renderPass));
+    HashCombine(seed, description.subpass);
+    return seed;
+}
+
+void PipelineRegistry::Create(VkDevice &device, PipelineCache &pipelineCache, ShaderLibrary &shaderLibrary) {
+    m_pipelineCache = &pipelineCache;
+    m_shaderLibrary = &shaderLibrary;
+    CreateLayouts(device);
+}
+
+void PipelineRegistry::Destroy(VkDevice &device) {
+    if (!m_pipelines.empty()) {
+        throw std::runtime_error("Failed to destroy the pipeline registry, pipelines are still in use!");
+    }
+    vkDestroyPipelineLayout(device, m_pipelineLayout, HostAllocator::GetCallbacks());
+    vkDestroyDescriptorSetLayout(device, m_descriptorSetLayout, HostAllocator::GetCallbacks());
+    m_pipelineLayout = VK_NULL_HANDLE;
+    m_descriptorSetLayout = VK_NULL_HANDLE;
+    m_pipelineCache = nullptr;
+    m_shaderLibrary = nullptr;
+}
+
+const SharedPipeline* PipelineRegistry::Acquire(const GraphicsPipelineDescription &description) {
+    ++m_acquireCount;
+    auto it = m_pipelines.find(description);
+    if (it == m_pipelines.end()) {
+        it = m_pipelines.emplace(description, SharedPipeline()).first;
+        it->second.description = &it->first;
+        m_pendingPipelines.push_back(&it->second);
+        ++m_createdCount;
+    }
+    ++it->second.referenceCount;
+    return &it->second;
+}
+
+void PipelineRegistry::Release(VkDevice &device, const SharedPipeline *sharedPipeline) {
+    auto it = m_pipelines.find(*sharedPipeline->description);
+    if (it == m_pipelines.end() || &it->second != sharedPipeline) {
+        throw std::runtime_error("Failed to release a pipeline that is not in the registry!");
+    }
+    if (--it->second.referenceCount > 0) {return;}
+    if (it->second.pipeline != VK_NULL_HANDLE) {
+        vkDestroyPipeline(device, it->second.pipeline, HostAllocator::GetCallbacks());
+    } else {
+        // removed before it was compiled, or its compilation failed
+        auto pending = std::find(m_pendingPipelines.begin(), m_pendingPipelines.end(), &it->second);
+        if (pending != m_pendingPipelines.end()) {
+            m_pendingPipelines.erase(pending);
+        }
+    }
+    m_pipelines.erase(it);
+}
+
+void PipelineRegistry::CompilePending(VkDevice &device, ThreadPool &threadPool) {
+    if (m_pendingPipelines.empty()) {return;}
+    auto startTime = std::chrono::high_resolution_clock::now();
+    // taken out of the registry first, so the list is empty however the compilation ends,
+    // and a pipeline compiled before a failing task is never compiled (and leaked) again
+    std::vector<SharedPipeline*> pendingPipelines;
+    pendingPipelines.swap(m_pendingPipelines);
+    pendingPipelines.erase(std::remove_if(pendingPipelines.begin(), pendingPipelines.end(),
+                                          [](const SharedPipeline* sharedPipeline) {return sharedPipeline->pipeline != VK_NULL_HANDLE;}),
+                           pendingPipelines.end());
+    // load the shader modules first, the library would serialize the tasks reading them
+    for (SharedPipeline* sharedPipeline : pendingPipelines) {
+        m_shaderLibrary->GetModule(device, sharedPipeline->description->vertexShader);
+        m_shaderLibrary->GetModule(device, sharedPipeline->description->fragmentShader);
+    }
+    // each task writes the pipeline of its own entry
+    uint32_t pipelineCount = static_cast<uint32_t>(pendingPipelines.size());
+    threadPool.ParallelFor(pipelineCount, [&](uint32_t task) {
+        SharedPipeline* sharedPipeline = pendingPipelines[task];
+        sharedPipeline->pipeline = CreatePipeline(device, *sharedPipeline->description);
+    });
+    auto endTime = std::chrono::high_resolution_clock::now();
+    m_compileTime += std::chrono::duration<double, std::milli>(endTime - startTime).count();
+    m_compileThreadCount = std::min(threadPool.GetWorkerCount(), pipelineCount);
+}
+
+void PipelineRegistry::PrintStatistics(std::ostream &out) const {
+    out << "Pipeline registry: " << m_createdCount << " pipelines created for " << m_acquireCount << " objects, "
+        << m_pipelines.size() << " in use, compiled in " << m_compileTime << " ms (" << m_compileThreadCount << " threads)" << std::endl;
+}
+
+void PipelineRegistry::CreateLayouts(VkDevice &device) {
+    // uniform buffer object binding (for vertex shader)
+    VkDescriptorSetLayoutBinding uboLayoutBinding{};
+    uboLayoutBinding.binding = 0;
+    // dynamic: the uniform ring offset of the frame is given when binding the descriptor set
+    uboLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+    uboLayoutBinding.descriptorCount = 1;
+    uboLayoutBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+    uboLayoutBinding.pImmutableSamplers = nullptr; // Optional
+
+    // texture sampler binding (for fragment shader)
+    VkDescriptorSetLayoutBinding samplerLayoutBinding{};
+    samplerLayoutBinding.binding = 1;
+    samplerLayoutBinding.descriptorCount = 1;
+    samplerLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    samplerLayoutBinding.pImmutableSamplers = nullptr;
+    samplerLayoutBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+
+    // array of two bindings
+    std::array<VkDescriptorSetLayoutBinding, 2> bindings = {uboLayoutBinding, samplerLayoutBinding};
+
+    // create descriptor set layout
+    VkDescriptorSetLayoutCreateInfo layoutInfo{};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+    layoutInfo.pBindings = bindings.data();
+
+    if (vkCreateDescriptorSetLayout(device, &layoutInfo, HostAllocator::GetCallbacks(), &m_descriptorSetLayout) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create descriptor set layout!");
+    }
+
+    /*pipeline layout*/
+    // specify the uniform values by creating VkPipelineLayout object
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo = {};
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    // bind with descriptor set layout for uniform buffer
+    pipelineLayoutInfo.setLayoutCount = 1;
+    pipelineLayoutInfo.pSetLayouts = &m_descriptorSetLayout;
+    pipelineLayoutInfo.pushConstantRangeCount = 0; // Optional
+    pipelineLayoutInfo.pPushConstantRanges = nullptr; // Optional
+    if (vkCreatePipelineLayout(device, &pipelineLayoutInfo, HostAllocator::GetCallbacks(), &m_pipelineLayout) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create pipeline layout!");
+    }
+}
+
+VkPipeline PipelineRegistry::CreatePipeline(VkDevice &device, const GraphicsPipelineDescription &description) {
+    // shader modules, loaded once and shared by all the pipelines
+    VkShaderModule vertShaderModule = m_shaderLibrary->GetModule(device, description.vertexShader);
+    VkShaderModule fragShaderModule = m_shaderLibrary->GetModule(device, description.fragmentShader);
+
+    /* shader stage creation*/
+    // vertex shader stage
+    VkPipelineShaderStageCreateInfo vertShaderStageInfo = {};
+    vertShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    vertShaderStageInfo.stage = VK_SHADER_STAGE_VERTEX_BIT;
+    vertShaderStageInfo.module = vertShaderModule;
+    vertShaderStageInfo.pName = "main";
+    // frag shader stage
+    VkPipelineShaderStageCreateInfo fragShaderStageInfo = {};
+    fragShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    fragShaderStageInfo.stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+    fragShaderStageInfo.module = fragShaderModule;
+    fragShaderStageInfo.pName = "main";
+    VkPipelineShaderStageCreateInfo shaderStages[] = {vertShaderStageInfo, fragShaderStageInfo};
+
+    // vertex input stage
+    VkPipelineVertexInputStateCreateInfo vertexInputInfo = {};
+    vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+    vertexInputInfo.vertexBindingDescriptionCount = 1;
+    vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(description.vertexAttributes.size());
+    vertexInputInfo.pVertexBindingDescriptions = &description.vertexBinding;
+    vertexInputInfo.pVertexAttributeDescriptions = description.vertexAttributes.data();
+
+    // input assembly stage
+    VkPipelineInputAssemblyStateCreateInfo inputAssembly = {};
+    inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+    inputAssembly.topology = description.topology;
+    inputAssembly.primitiveRestartEnable = VK_FALSE;
+
+    // viewport and scissors stage (set in the command buffer, see the dynamic state)
+    VkPipelineViewportStateCreateInfo viewportState = {};
+    viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+    viewportState.viewportCount = 1;
+    viewportState.pViewports = nullptr;
+    viewportState.scissorCount = 1;
+    viewportState.pScissors = nullptr;
+
+    // rasterizer stage
+    VkPipelineRasterizationStateCreateInfo rasterizer = {};
+    rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+    rasterizer.depthClampEnable = VK_FALSE;
+    rasterizer.rasterizerDiscardEnable = VK_FALSE;
+    rasterizer.polygonMode = description.polygonMode;
+    rasterizer.lineWidth = 1.0f;
+    rasterizer.cullMode = description.cullMode;
+    rasterizer.frontFace = description.frontFace; // counter if using projection matrix
+    rasterizer.depthBiasEnable = VK_FALSE;
+    rasterizer.depthBiasConstantFactor = 0.0f;
+    rasterizer.depthBiasClamp = 0.0f;
+    rasterizer.depthBiasSlopeFactor = 0.0f;
+
+    // multisampling stage
+    VkPipelineMultisampleStateCreateInfo multisampling = {};
+    multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+    multisampling.sampleShadingEnable = VK_FALSE;
+    multisampling.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+    multisampling.minSampleShading = 1.0f; // Optional
+    multisampling.pSampleMask = nullptr; // Optional
+    multisampling.alphaToCoverageEnable = VK_FALSE; // Optional
+    multisampling.alphaToOneEnable = VK_FALSE; // Optional
+
+    // TODO depth and stencil testing
+
+    // color blending stage
+    VkPipelineColorBlendAttachmentState colorBlendAttachment = {};
+    colorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+    colorBlendAttachment.blendEnable = description.blendEnable ? VK_TRUE : VK_FALSE;
+    colorBlendAttachment.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
+    colorBlendAttachment.dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+    colorBlendAttachment.colorBlendOp = VK_BLEND_OP_ADD;
+    colorBlendAttachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+    colorBlendAttachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
+    colorBlendAttachment.alphaBlendOp = VK_BLEND_OP_ADD;
+
+    VkPipelineColorBlendStateCreateInfo colorBlending = {};
+    colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+    colorBlending.logicOpEnable = VK_FALSE;
+    colorBlending.logicOp = VK_LOGIC_OP_COPY; // Optional
+    colorBlending.attachmentCount = 1;
+    colorBlending.pAttachments = &colorBlendAttachment;
+    colorBlending.blendConstants[0] = 0.0f; // Optional
+    colorBlending.blendConstants[1] = 0.0f; // Optional
+    colorBlending.blendConstants[2] = 0.0f; // Optional
+    colorBlending.blendConstants[3] = 0.0f; // Optional
+
+    // dynamic state, viewport and scissor follow the swap chain extent without recreating the pipeline
+    std::array<VkDynamicState, 2> dynamicStates = {VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR};
+    VkPipelineDynamicStateCreateInfo dynamicState = {};
+    dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+    dynamicState.dynamicStateCount = static_cast<uint32_t>(dynamicStates.size());
+    dynamicState.pDynamicStates = dynamicStates.data();
+
+    // create graphics pipeline
+    VkGraphicsPipelineCreateInfo pipelineInfo = {};
+    pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+    pipelineInfo.stageCount = 2;
+    pipelineInfo.pStages = shaderStages;
+    pipelineInfo.pVertexInputState = &vertexInputInfo;
+    pipelineInfo.pInputAssemblyState = &inputAssembly;
+    pipelineInfo.pViewportState = &viewportState;
+    pipelineInfo.pRasterizationState = &rasterizer;
+    pipelineInfo.pMultisampleState = &multisampling;
+    pipelineInfo.pDepthStencilState = nullptr; // Optional
+    pipelineInfo.pColorBlendState = &colorBlending;
+    pipelineInfo.pDynamicState = &dynamicState;
+    pipelineInfo.layout = m_pipelineLayout;
+    pipelineInfo.renderPass = description.renderPass;
+    pipelineInfo.subpass = description.subpass;
+    pipelineInfo.basePipelineHandle = VK_NULL_HANDLE; // Optional
+    pipelineInfo.basePipelineIndex = -1; // Optional
+    VkPipeline pipeline;
+    m_pipelineCache->CreateGraphicsPipelines(device, 1, &pipelineInfo, &pipeline);
+    return pipeline;
+}
@@ -0,0 +1,110 @@
+#ifndef VULKANBASICS_PIPELINEREGISTRY_H
+#define VULKANBASICS_PIPELINEREGISTRY_H
+#include <vulkan/vulkan.h>
+#include <cstdint>
+#include <functional>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "PipelineCache.h"
+#include "ShaderLibrary.h"
+#include "ThreadPool.h"
+
+// everything a graphics pipeline of an object is built from, two objects with equal descriptions share the pipeline
+struct GraphicsPipelineDescription {
+    // SPIR-V files
+    std::string vertexShader;
+    std::string fragmentShader;
+    // vertex layout
+    VkVertexInputBindingDescription vertexBinding{};
+    std::vector<VkVertexInputAttributeDescription> vertexAttributes;
+    VkPrimitiveTopology topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+    // rasterization state
+    VkPolygonMode polygonMode = VK_POLYGON_MODE_FILL;
+    VkCullModeFlags cullMode = VK_CULL_MODE_BACK_BIT;
+    VkFrontFace frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
+    // alpha blending of the color attachment
+    bool blendEnable = true;
+    VkRenderPass renderPass = VK_NULL_HANDLE;
+    uint32_t subpass = 0;
+
+    bool operator==(const GraphicsPipelineDescription& other) const;
+};
+
+// hash calculation for GraphicsPipelineDescription struct
+namespace std {
+    template<> struct hash<GraphicsPipelineDescription> {
+        size_t operator()(GraphicsPipelineDescription const& description) const;
+    };
+}
+
+// a pipeline of the registry and the objects using it
+struct SharedPipeline {
+    // VK_NULL_HANDLE until the registry has compiled it (CompilePending)
+    VkPipeline pipeline = VK_NULL_HANDLE;
+    uint32_t referenceCount = 0;
+    // key of the pipeline in the registry
+    const GraphicsPipelineDescription* description = nullptr;
+};
+
+// Graphics pipelines of the objects, created once for each distinct description and shared by all the objects using it.
+// All the objects have the same descriptor set layout (dynamic uniform buffer and combined image sampler),
+// so the registry owns one descriptor set layout and one pipeline layout for every pipeline.
+// Acquiring a new description only registers it, CompilePending() then compiles all the pipelines registered since
+// the last call concurrently on a thread pool (the pipeline cache and the shader library are thread safe), one pipeline
+// per task, so only a scene with many distinct pipelines can use more than a few threads (the demo scene has two).
+// How well the compilation scales depends on the driver (some serialize vkCreateGraphicsPipelines on one cache).
+// A pipeline is destroyed when the last object using it releases it.
+class PipelineRegistry {
+public:
+    // the pipelines are created with the pipeline cache and the shader modules of the library, which must outlive the registry
+    void Create(VkDevice& device, PipelineCache& pipelineCache, ShaderLibrary& shaderLibrary);
+    // all the pipelines must have been released
+    void Destroy(VkDevice& device);
+
+    // the pipeline of the description, registered for the next CompilePending if no object uses it yet.
+    // The pointer stays valid until the pipeline is released by all its objects.
+    const SharedPipeline* Acquire(const GraphicsPipelineDescription& description);
+    // an object stops using the pipeline, no frame may still draw with it
+    void Release(VkDevice& device, const SharedPipeline* sharedPipeline);
+
+    // compile the pipelines registered since the last call, one task per pipeline, before they are drawn with.
+    // If a compilation throws, the pending list is dropped and the pipelines that failed stay VK_NULL_HANDLE.
+    void CompilePending(VkDevice& device, ThreadPool& threadPool);
+    inline bool HasPendingPipelines() const {return !m_pendingPipelines.empty();}
+
+    inline VkDescriptorSetLayout GetDescriptorSetLayout() const {return m_descriptorSetLayout;}
+    inline VkPipelineLayout GetPipelineLayout() const {return m_pipelineLayout;}
+    inline size_t GetPipelineCount() const {return m_pipelines.size();}
+    // Acquire calls, and the ones that had to create a pipeline
+    inline uint64_t GetAcquireCount() const {return m_acquireCount;}
+    inline uint64_t GetCreatedCount() const {return m_createdCount;}
+    // wall time of all the CompilePending calls (milliseconds)
+    inline double GetCompileTime() const {return m_compileTime;}
+    void PrintStatistics(std::ostream& out) const;
+
+private:
+    void CreateLayouts(VkDevice& device);
+    VkPipeline CreatePipeline(VkDevice& device, const GraphicsPipelineDescription& description);
+
+private:
+    PipelineCache* m_pipelineCache = nullptr;
+    ShaderLibrary* m_shaderLibrary = nullptr;
+    VkDescriptorSetLayout m_descriptorSetLayout = VK_NULL_HANDLE;
+    VkPipelineLayout m_pipelineLayout = VK_NULL_HANDLE;
+
+    // elements of an unordered_map don't move, the objects keep pointers to them
+    std::unordered_map<GraphicsPipelineDescription, SharedPipeline> m_pipelines;
+    // registered, not compiled yet
+    std::vector<SharedPipeline*> m_pendingPipelines;
+
+    uint64_t m_acquireCount = 0;
+    uint64_t m_createdCount = 0;
+    double m_compileTime = 0.0;
+    // threads of the last CompilePending
+    uint32_t m_compileThreadCount = 0;
+};
+
+
+#endif //VULKANBASICS_PIPELINEREGISTRY_H
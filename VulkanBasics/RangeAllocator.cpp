@@ -0,0 +1,95 @@
+#include "RangeAllocator.h"
+#include <stdexcept>
+
+RangeAllocator::RangeAllocator(uint64_t size) {
+    Reset(size);
+}
+
+void RangeAllocator::Reset(uint64_t size) {
+    m_size = size;
+    m_freeSize = 0;
+    m_freeRanges.clear();
+    m_freeRangesBySize.clear();
+    if (size > 0) {
+        InsertFreeRange(0, size);
+    }
+}
+
+void RangeAllocator::Grow(uint64_t size) {
+    if (size <= m_size) {return;}
+    uint64_t oldSize = m_size;
+    m_size = size;
+    // the new tail is merged with a free range at the old end
+    Free(oldSize, size - oldSize);
+}
+
+bool RangeAllocator::Allocate(uint64_t size, uint64_t alignment, uint64_t &offset) {
+    if (size == 0) {return false;}
+    if (alignment == 0) {alignment = 1;}
+    // best fit: the smallest ranges first, a range may still be too small once its start is aligned
+    for (auto bySize = m_freeRangesBySize.lower_bound(size); bySize != m_freeRangesBySize.end(); ++bySize) {
+        uint64_t rangeOffset = bySize->second;
+        uint64_t rangeSize = bySize->first;
+        uint64_t alignedOffset = (rangeOffset + alignment - 1) & ~(alignment - 1);
+        uint64_t padding = alignedOffset - rangeOffset;
+        if (padding + size > rangeSize) {continue;}
+
+        EraseFreeRange(m_freeRanges.find(rangeOffset));
+        // the padding before and the rest after the allocation stay free
+        if (padding > 0) {
+            InsertFreeRange(rangeOffset, padding);
+        }
+        if (padding + size < rangeSize) {
+            InsertFreeRange(alignedOffset + size, rangeSize - padding - size);
+        }
+        offset = alignedOffset;
+        return true;
+    }
+    return false;
+}
+
+void RangeAllocator::Free(uint64_t offset, uint64_t size) {
+    if (size == 0) {return;}
+    if (offset + size > m_size) {
+        throw std::runtime_error("Failed to free a range outside of the allocator!");
+    }
+    // merge with the free neighbours
+    auto next = m_freeRanges.lower_bound(offset);
+    if (next != m_freeRanges.end() && next->first == offset + size) {
+        size += next->second;
+        EraseFreeRange(next);
+    }
+    auto previous = m_freeRanges.lower_bound(offset);
+    if (previous != m_freeRanges.begin()) {
+        --previous;
+        if (previous->first + previous->second == offset) {
+            offset = previous->first;
+            size += previous->second;
+            EraseFreeRange(previous);
+        }
+    }
+    InsertFreeRange(offset, size);
+}
+
+uint64_t RangeAllocator::GetLargestFreeRange() const {
+    return m_freeRangesBySize.empty() ? 0 : m_freeRangesBySize.rbegin()->first;
+}
+
+void RangeAllocator::InsertFreeRange(uint64_t offset, uint64_t size) {
+    m_freeRanges.emplace(offset, size);
+    m_freeRangesBySize.emplace(size, offset);
+    m_freeSize += size;
+}
+
+void RangeAllocator::EraseFreeRange(std::map<uint64_t, uint64_t>::iterator range) {
+    // several ranges can have the same size
+    auto bySize = m_freeRangesBySize.equal_range(range->second);
+    for (auto it = bySize.first; it != bySize.second; ++it) {
+        if (it->second == range->first) {
+            m_freeRangesBySize.erase(it);
+            break;
+        }
+    }
+    m_freeSize -= range->second;
+    m_freeRanges.erase(range);
+}
@@ -0,0 +1,45 @@
+#ifndef VULKANBASICS_RANGEALLOCATOR_H
+#define VULKANBASICS_RANGEALLOCATOR_H
+#include <cstdint>
+#include <cstddef>
+#include <map>
+
+// Free-list allocator of offsets in a range [0, size), e.g. in a block of device memory.
+// Free ranges are kept by offset (to merge neighbours when freeing) and by size (best fit),
+// so finding a fit is an O(log n) lookup in the number of free ranges, linear when alignment
+// padding rejects candidates, and freeing is O(log n).
+class RangeAllocator {
+public:
+    explicit RangeAllocator(uint64_t size = 0);
+
+    // forget all the allocations
+    void Reset(uint64_t size);
+    // extend the range to size, the allocations keep their offsets
+    void Grow(uint64_t size);
+
+    // find the smallest free range that fits size bytes at the alignment (power of two), false if none fits
+    bool Allocate(uint64_t size, uint64_t alignment, uint64_t& offset);
+    // give back a range returned by Allocate
+    void Free(uint64_t offset, uint64_t size);
+
+    inline uint64_t GetSize() const {return m_size;}
+    inline uint64_t GetFreeSize() const {return m_freeSize;}
+    inline bool IsEmpty() const {return m_freeSize == m_size;}
+    inline size_t GetFreeRangeCount() const {return m_freeRanges.size();}
+    uint64_t GetLargestFreeRange() const;
+
+private:
+    void InsertFreeRange(uint64_t offset, uint64_t size);
+    void EraseFreeRange(std::map<uint64_t, uint64_t>::iterator range);
+
+private:
+    uint64_t m_size = 0;
+    uint64_t m_freeSize = 0;
+    // offset -> size
+    std::map<uint64_t, uint64_t> m_freeRanges;
+    // size -> offset
+    std::multimap<uint64_t, uint64_t> m_freeRangesBySize;
+};
+
+
+#endif //VULKANBASICS_RANGEALLOCATOR_H
@@ -0,0 +1,68 @@
+#include "ShaderLibrary.h"
+#include <fstream>
+#include <stdexcept>
+#include "HostAllocator.h"
+
+// first word of every SPIR-V module
+#define SPIRV_MAGIC_NUMBER 0x07230203u
+// magic number, version, generator, bound and schema
+#define SPIRV_HEADER_WORD_COUNT 5
+
+void ShaderLibrary::Destroy(VkDevice &device) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (auto& module : m_modules) {
+        vkDestroyShaderModule(device, module.second, HostAllocator::GetCallbacks());
+    }
+    m_modules.clear();
+    m_codeBytes = 0;
+}
+
+VkShaderModule ShaderLibrary::GetModule(VkDevice &device, const std::string &fileName) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    ++m_requestCount;
+    auto it = m_modules.find(fileName);
+    if (it != m_modules.end()) {
+        return it->second;
+    }
+
+    std::vector<uint32_t> shaderCode = ReadSpirvFile(fileName);
+    VkShaderModuleCreateInfo createInfo = {};
+    createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+    createInfo.codeSize = shaderCode.size() * sizeof(uint32_t);
+    createInfo.pCode = shaderCode.data();
+    VkShaderModule shaderModule;
+    if (vkCreateShaderModule(device, &createInfo, HostAllocator::GetCallbacks(), &shaderModule) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create shader module: " + fileName);
+    }
+    m_modules[fileName] = shaderModule;
+    m_codeBytes += createInfo.codeSize;
+    return shaderModule;
+}
+
+void ShaderLibrary::PrintStatistics(std::ostream &out) const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    out << "Shader library: " << m_modules.size() << " modules (" << m_codeBytes << " bytes of SPIR-V) for "
+        << m_requestCount << " shader stages" << std::endl;
+}
+
+std::vector<uint32_t> ShaderLibrary::ReadSpirvFile(const std::string &fileName) {
+    // ate: read file at the end of file
+    std::ifstream file(fileName, std::ios::ate | std::ios::binary);
+    if (!file.is_open()) {
+        throw std::runtime_error("Failed to open file: " + fileName);
+    }
+    size_t fileSize = (size_t) file.tellg();
+    // the code is a stream of 32 bit words
+    if (fileSize % sizeof(uint32_t) != 0 || fileSize < SPIRV_HEADER_WORD_COUNT * sizeof(uint32_t)) {
+        throw std::runtime_error("Failed to load shader, not a SPIR-V file: " + fileName);
+    }
+    std::vector<uint32_t> shaderCode(fileSize / sizeof(uint32_t));
+    file.seekg(0);
+    if (!file.read(reinterpret_cast<char*>(shaderCode.data()), static_cast<std::streamsize>(fileSize))) {
+        throw std::runtime_error("Failed to read file: " + fileName);
+    }
+    if (shaderCode[0] != SPIRV_MAGIC_NUMBER) {
+        throw std::runtime_error("Failed to load shader, not a SPIR-V file: " + fileName);
+    }
+    return shaderCode;
+}
@@ -0,0 +1,40 @@
+#ifndef VULKANBASICS_SHADERLIBRARY_H
+#define VULKANBASICS_SHADERLIBRARY_H
+#include <vulkan/vulkan.h>
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Shader modules of the SPIR-V files, loaded the first time a pipeline uses them and kept alive until Destroy(),
+// so adding objects costs one file read and one vkCreateShaderModule per distinct shader.
+// The code is kept in 32 bit words (the alignment pCode requires) and checked for the SPIR-V magic number.
+class ShaderLibrary {
+public:
+    // destroy all the shader modules, no pipeline may be being created
+    void Destroy(VkDevice& device);
+
+    // the module of the SPIR-V file, loaded and created on first use (thread safe)
+    VkShaderModule GetModule(VkDevice& device, const std::string& fileName);
+
+    inline size_t GetModuleCount() const {return m_modules.size();}
+    // GetModule calls, and the ones that had to read the file
+    inline uint64_t GetRequestCount() const {return m_requestCount;}
+    void PrintStatistics(std::ostream& out) const;
+
+private:
+    // the words of the SPIR-V file, throws if it isn't SPIR-V
+    static std::vector<uint32_t> ReadSpirvFile(const std::string& fileName);
+
+private:
+    std::unordered_map<std::string, VkShaderModule> m_modules;
+    uint64_t m_requestCount = 0;
+    // size of the SPIR-V code of all the modules
+    size_t m_codeBytes = 0;
+    mutable std::mutex m_mutex;
+};
+
+
+#endif //VULKANBASICS_SHADERLIBRARY_H
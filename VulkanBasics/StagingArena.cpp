@@ -0,0 +1,95 @@
+#include "StagingArena.h"
+#include <algorithm>
+#include "VulkanHelperFunctions.h"
+
+void StagingArena::Create(VkDevice &device, DeviceMemoryAllocator &allocator, VkDeviceSize chunkSize) {
+    m_chunkSize = chunkSize;
+    m_createdChunkCount = 0;
+    AddChunk(device, allocator, m_chunkSize);
+}
+
+void StagingArena::Destroy(VkDevice &device, DeviceMemoryAllocator &allocator) {
+    for (Chunk& chunk : m_chunks) {
+        VulkanHelperFunctions::DestroyBuffer(device, allocator, chunk.buffer, chunk.memory);
+    }
+    m_chunks.clear();
+    m_currentChunk = 0;
+    m_usedBytes = 0;
+}
+
+StagingAllocation StagingArena::Allocate(VkDevice &device, DeviceMemoryAllocator &allocator, VkDeviceSize size, VkDeviceSize alignment) {
+    VkDeviceSize offset = 0;
+    bool fits = false;
+    if (m_currentChunk < m_chunks.size()) {
+        const Chunk& current = m_chunks[m_currentChunk];
+        offset = (current.head + alignment - 1) & ~(alignment - 1);
+        fits = offset + size <= current.size;
+    }
+    if (!fits) {
+        // the full chunk may still be read by copies in flight, it is reused once Recycle() finds them completed
+        offset = 0;
+        m_currentChunk = m_chunks.size();
+        for (size_t i = 0; i < m_chunks.size(); i++) {
+            if (m_chunks[i].head == 0 && m_chunks[i].size >= size) {
+                m_currentChunk = i;
+                break;
+            }
+        }
+        if (m_currentChunk == m_chunks.size()) {
+            AddChunk(device, allocator, std::max(m_chunkSize, size));
+        }
+    }
+    Chunk& chunk = m_chunks[m_currentChunk];
+    chunk.head = offset + size;
+    chunk.inCurrentBatch = true;
+    m_usedBytes += size;
+
+    StagingAllocation allocation;
+    allocation.buffer = chunk.buffer;
+    allocation.offset = offset;
+    allocation.mappedData = static_cast<char*>(chunk.memory.mappedData) + offset;
+    return allocation;
+}
+
+void StagingArena::EndBatch(uint64_t batchValue) {
+    for (Chunk& chunk : m_chunks) {
+        if (chunk.inCurrentBatch) {
+            chunk.batchValue = batchValue;
+            chunk.inCurrentBatch = false;
+        }
+    }
+    m_usedBytes = 0;
+}
+
+void StagingArena::Recycle(VkDevice &device, DeviceMemoryAllocator &allocator, uint64_t completedValue) {
+    bool keptIdleChunk = false;
+    for (size_t i = 0; i < m_chunks.size();) {
+        Chunk& chunk = m_chunks[i];
+        if (chunk.inCurrentBatch || chunk.batchValue > completedValue) {
+            ++i;
+            continue;
+        }
+        chunk.head = 0;
+        // the current chunk stays, of the others one idle chunk of the default size is kept for the next batches
+        if (i == m_currentChunk || (!keptIdleChunk && chunk.size == m_chunkSize)) {
+            keptIdleChunk = keptIdleChunk || i != m_currentChunk;
+            ++i;
+            continue;
+        }
+        VulkanHelperFunctions::DestroyBuffer(device, allocator, chunk.buffer, chunk.memory);
+        m_chunks.erase(m_chunks.begin() + static_cast<std::ptrdiff_t>(i));
+        if (m_currentChunk > i) {
+            --m_currentChunk;
+        }
+    }
+}
+
+void StagingArena::AddChunk(VkDevice &device, DeviceMemoryAllocator &allocator, VkDeviceSize size) {
+    Chunk chunk;
+    chunk.size = size;
+    VulkanHelperFunctions::CreateBuffer(device, allocator, size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                                        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, MemoryCategory::Staging, chunk.buffer, chunk.memory);
+    m_chunks.push_back(chunk);
+    m_currentChunk = m_chunks.size() - 1;
+    m_createdChunkCount++;
+}
@@ -0,0 +1,62 @@
+#ifndef VULKANBASICS_STAGINGARENA_H
+#define VULKANBASICS_STAGINGARENA_H
+#include <vulkan/vulkan.h>
+#include <cstdint>
+#include <vector>
+#include "DeviceMemoryAllocator.h"
+
+// space handed out by the staging arena, the source of a copy command
+struct StagingAllocation {
+    VkBuffer buffer = VK_NULL_HANDLE;
+    VkDeviceSize offset = 0;
+    // host address of the space (persistently mapped)
+    void* mappedData = nullptr;
+};
+
+// Long-lived, persistently mapped host memory for uploading vertex, index and texture data.
+// Space is handed out linearly from large staging buffers (chunks), so a batch of uploads doesn't create a
+// staging buffer for each resource. When a chunk is full the next free one is used, or another one is added.
+// EndBatch() tags the chunks the batch used with the upload timeline value of its submission, and Recycle() frees a
+// chunk once the completed value has passed its tag, so uploads every frame cycle through a few chunks without waiting.
+class StagingArena {
+public:
+    void Create(VkDevice& device, DeviceMemoryAllocator& allocator, VkDeviceSize chunkSize);
+    void Destroy(VkDevice& device, DeviceMemoryAllocator& allocator);
+
+    // space for size bytes at the alignment (power of two, multiple of the texel size for image copies)
+    StagingAllocation Allocate(VkDevice& device, DeviceMemoryAllocator& allocator, VkDeviceSize size, VkDeviceSize alignment = 16);
+    // the copies from the space allocated since the last call were submitted in the batch signaling batchValue
+    void EndBatch(uint64_t batchValue);
+    // reuse the chunks whose batches have completed, keeping one idle chunk of the default size for the next batches
+    void Recycle(VkDevice& device, DeviceMemoryAllocator& allocator, uint64_t completedValue);
+
+    // staging buffers created since Create()
+    inline uint64_t GetCreatedChunkCount() const {return m_createdChunkCount;}
+    // bytes handed out in the current batch
+    inline VkDeviceSize GetUsedBytes() const {return m_usedBytes;}
+
+private:
+    struct Chunk {
+        VkBuffer buffer = VK_NULL_HANDLE;
+        MemoryAllocation memory;
+        VkDeviceSize size = 0;
+        // next free byte, 0 when the chunk is idle
+        VkDeviceSize head = 0;
+        // the current batch allocated from it
+        bool inCurrentBatch = false;
+        // value of the last submitted batch that allocated from it
+        uint64_t batchValue = 0;
+    };
+    void AddChunk(VkDevice& device, DeviceMemoryAllocator& allocator, VkDeviceSize size);
+
+private:
+    VkDeviceSize m_chunkSize = 0;
+    std::vector<Chunk> m_chunks;
+    // chunk the allocations are handed out from
+    size_t m_currentChunk = 0;
+    VkDeviceSize m_usedBytes = 0;
+    uint64_t m_createdChunkCount = 0;
+};
+
+
+#endif //VULKANBASICS_STAGINGARENA_H
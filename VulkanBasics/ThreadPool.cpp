@@ -0,0 +1,99 @@
+#include "ThreadPool.h"
+
+ThreadPool::~ThreadPool() {
+    Stop();
+}
+
+void ThreadPool::Start(uint32_t threadCount) {
+    Stop();
+    m_stopping = false;
+    for (uint32_t i = 0; i < threadCount; i++) {
+        m_threads.emplace_back(&ThreadPool::WorkerLoop, this);
+    }
+}
+
+void ThreadPool::Stop() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_jobStarted.notify_all();
+    for (std::thread& thread : m_threads) {
+        thread.join();
+    }
+    m_threads.clear();
+}
+
+void ThreadPool::ParallelFor(uint32_t taskCount, const std::function<void(uint32_t)> &task) {
+    if (taskCount == 0) {return;}
+    // nothing to share, skip waking the workers
+    if (m_threads.empty() || taskCount == 1) {
+        for (uint32_t i = 0; i < taskCount; i++) {
+            task(i);
+        }
+        return;
+    }
+
+    // a new job for each call, the task counter of a previous job may still be read by a worker finishing it
+    std::shared_ptr<Job> job = std::make_shared<Job>();
+    job->task = &task;
+    job->taskCount = taskCount;
+    job->unfinishedTasks = taskCount;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_job = job;
+        m_jobGeneration++;
+    }
+    m_jobStarted.notify_all();
+
+    RunTasks(*job);
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_jobFinished.wait(lock, [&] {return job->unfinishedTasks == 0;});
+    m_job.reset();
+    if (job->exception) {
+        std::rethrow_exception(job->exception);
+    }
+}
+
+void ThreadPool::WorkerLoop() {
+    uint64_t finishedGeneration = 0;
+    while (true) {
+        std::shared_ptr<Job> job;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_jobStarted.wait(lock, [&] {return m_stopping || m_jobGeneration != finishedGeneration;});
+            if (m_stopping) {return;}
+            finishedGeneration = m_jobGeneration;
+            // the job may already have finished and been cleared
+            job = m_job;
+        }
+        if (job) {
+            RunTasks(*job);
+        }
+    }
+}
+
+void ThreadPool::RunTasks(Job &job) {
+    uint32_t finishedTasks = 0;
+    std::exception_ptr exception;
+    // the task counter hands out each index of this job once, the task is only used while tasks are unfinished
+    for (uint32_t taskIndex = job.nextTask.fetch_add(1); taskIndex < job.taskCount; taskIndex = job.nextTask.fetch_add(1)) {
+        try {
+            (*job.task)(taskIndex);
+        } catch (...) {
+            if (!exception) {exception = std::current_exception();}
+        }
+        finishedTasks++;
+    }
+    if (finishedTasks == 0) {return;}
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (exception && !job.exception) {
+        job.exception = exception;
+    }
+    job.unfinishedTasks -= finishedTasks;
+    if (job.unfinishedTasks == 0) {
+        m_jobFinished.notify_all();
+    }
+}
@@ -0,0 +1,63 @@
+#ifndef VULKANBASICS_THREADPOOL_H
+#define VULKANBASICS_THREADPOOL_H
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads running parallel-for jobs.
+// The thread calling ParallelFor works on the tasks too, so a pool without threads runs everything inline.
+class ThreadPool {
+public:
+    ThreadPool() = default;
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    void Start(uint32_t threadCount);
+    void Stop();
+
+    // threads working on a ParallelFor, including the calling thread
+    inline uint32_t GetWorkerCount() const {return static_cast<uint32_t>(m_threads.size()) + 1;}
+
+    // run task(taskIndex) for each task index and block until all of them have finished,
+    // the first exception thrown by a task is rethrown here
+    void ParallelFor(uint32_t taskCount, const std::function<void(uint32_t)>& task);
+
+private:
+    // state of one ParallelFor, a worker waking late keeps the job it has woken for and never touches the next one
+    struct Job {
+        const std::function<void(uint32_t)>* task = nullptr;
+        uint32_t taskCount = 0;
+        std::atomic<uint32_t> nextTask{0};
+        // tasks not finished yet, guarded by m_mutex
+        uint32_t unfinishedTasks = 0;
+        std::exception_ptr exception;
+    };
+
+    void WorkerLoop();
+    // run tasks of the job until there are none left
+    void RunTasks(Job& job);
+
+private:
+    std::vector<std::thread> m_threads;
+    std::mutex m_mutex;
+    // wakes the workers when a job starts or the pool stops
+    std::condition_variable m_jobStarted;
+    // wakes ParallelFor when the last task has finished
+    std::condition_variable m_jobFinished;
+    bool m_stopping = false;
+    // incremented for each job, so that a worker runs each job once
+    uint64_t m_jobGeneration = 0;
+    // the current job, guarded by m_mutex (workers hold a reference while running its tasks)
+    std::shared_ptr<Job> m_job;
+};
+
+
+#endif //VULKANBASICS_THREADPOOL_H
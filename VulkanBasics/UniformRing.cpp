@@ -0,0 +1,73 @@
+#include "UniformRing.h"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include "VulkanHelperFunctions.h"
+
+void UniformRing::Create(VkDevice &device, VkPhysicalDevice &physicalDevice, DeviceMemoryAllocator &allocator,
+                         uint32_t frameCount, VkDeviceSize bytesPerFrame) {
+    VkPhysicalDeviceProperties properties{};
+    vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+    // the limit is a power of two
+    m_alignment = std::max<VkDeviceSize>(properties.limits.minUniformBufferOffsetAlignment, 1);
+    m_frameCount = frameCount;
+    m_bytesPerFrame = AlignSize(std::max<VkDeviceSize>(bytesPerFrame, m_alignment));
+    CreateBuffer(device, allocator);
+}
+
+void UniformRing::Destroy(VkDevice &device, DeviceMemoryAllocator &allocator) {
+    if (m_buffer != VK_NULL_HANDLE) {
+        VulkanHelperFunctions::DestroyBuffer(device, allocator, m_buffer, m_memory);
+    }
+}
+
+bool UniformRing::Reserve(VkDevice &device, DeviceMemoryAllocator &allocator, VkDeviceSize bytesPerFrame,
+                          VkBuffer &oldBuffer, MemoryAllocation &oldMemory) {
+    if (bytesPerFrame <= m_bytesPerFrame) {return false;}
+    // grow geometrically, so that adding objects one by one doesn't recreate the buffer every time
+    m_bytesPerFrame = AlignSize(std::max(bytesPerFrame, m_bytesPerFrame * 2));
+    oldBuffer = m_buffer;
+    oldMemory = m_memory;
+    m_buffer = VK_NULL_HANDLE;
+    m_memory = MemoryAllocation();
+    CreateBuffer(device, allocator);
+    return true;
+}
+
+void UniformRing::BeginFrame(uint32_t frameIndex) {
+    m_frameOffset = frameIndex * m_bytesPerFrame;
+    m_head = 0;
+}
+
+uint32_t UniformRing::Push(const void *data, VkDeviceSize size) {
+    if (m_head + size > m_bytesPerFrame) {
+        throw std::runtime_error("Failed to push uniform data, the frame's region of the uniform ring is full!");
+    }
+    VkDeviceSize offset = m_frameOffset + m_head;
+    memcpy(static_cast<char*>(m_memory.mappedData) + offset, data, static_cast<size_t>(size));
+    m_head += AlignSize(size);
+    return static_cast<uint32_t>(offset);
+}
+
+void UniformRing::CreateBuffer(VkDevice &device, DeviceMemoryAllocator &allocator) {
+    // coherent, so the writes are visible to the GPU at submission without flushing,
+    // and device local when the host can write it, so the shaders don't read the uniforms over the bus
+    VkMemoryPropertyFlags properties = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+    VkDeviceSize size = m_bytesPerFrame * m_frameCount;
+    bool created = false;
+    if (allocator.SupportsDirectUpload(size)) {
+        try {
+            VulkanHelperFunctions::CreateBuffer(device, allocator, size, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+                                                properties | VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, MemoryCategory::Uniform, m_buffer, m_memory);
+            created = true;
+        } catch (const std::runtime_error&) {
+            // the host visible device local heap is full, fall back to host memory
+        }
+    }
+    if (!created) {
+        VulkanHelperFunctions::CreateBuffer(device, allocator, size, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+                                            properties, MemoryCategory::Uniform, m_buffer, m_memory);
+    }
+    m_frameOffset = 0;
+    m_head = 0;
+}
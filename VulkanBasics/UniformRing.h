@@ -0,0 +1,50 @@
+#ifndef VULKANBASICS_UNIFORMRING_H
+#define VULKANBASICS_UNIFORMRING_H
+#include <vulkan/vulkan.h>
+#include <cstdint>
+#include "DeviceMemoryAllocator.h"
+
+// One persistently mapped uniform buffer shared by all the objects, split into a region for each frame in flight.
+// Every frame the objects push their uniform data into the region of the frame at offsets aligned to
+// minUniformBufferOffsetAlignment, and bind it with a dynamic offset (VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC),
+// so a single descriptor set per object works for all the frames.
+// A region must only be written again after the last submission of its frame has completed.
+class UniformRing {
+public:
+    // bytesPerFrame is rounded up to the alignment
+    void Create(VkDevice& device, VkPhysicalDevice& physicalDevice, DeviceMemoryAllocator& allocator, uint32_t frameCount, VkDeviceSize bytesPerFrame);
+    void Destroy(VkDevice& device, DeviceMemoryAllocator& allocator);
+
+    // create a bigger buffer if a frame needs more than the current region, true if the buffer handle changed
+    // (the objects then need descriptor sets of the new buffer). The old buffer is handed back in oldBuffer and oldMemory,
+    // the frames in flight may still read it, so it is destroyed once they have finished
+    bool Reserve(VkDevice& device, DeviceMemoryAllocator& allocator, VkDeviceSize bytesPerFrame, VkBuffer& oldBuffer, MemoryAllocation& oldMemory);
+
+    // start writing the region of a frame in flight
+    void BeginFrame(uint32_t frameIndex);
+    // copy data into the region of the current frame, returns the dynamic offset to bind it with
+    uint32_t Push(const void* data, VkDeviceSize size);
+
+    inline VkBuffer GetBuffer() const {return m_buffer;}
+    inline VkDeviceSize GetAlignment() const {return m_alignment;}
+    inline VkDeviceSize GetBytesPerFrame() const {return m_bytesPerFrame;}
+    // size of data rounded up to the alignment
+    inline VkDeviceSize AlignSize(VkDeviceSize size) const {return (size + m_alignment - 1) & ~(m_alignment - 1);}
+
+private:
+    void CreateBuffer(VkDevice& device, DeviceMemoryAllocator& allocator);
+
+private:
+    VkBuffer m_buffer = VK_NULL_HANDLE;
+    MemoryAllocation m_memory;
+    VkDeviceSize m_alignment = 256;
+    uint32_t m_frameCount = 0;
+    VkDeviceSize m_bytesPerFrame = 0;
+
+    // start of the current frame's region, and the next free byte in it
+    VkDeviceSize m_frameOffset = 0;
+    VkDeviceSize m_head = 0;
+};
+
+
+#endif //VULKANBASICS_UNIFORMRING_H
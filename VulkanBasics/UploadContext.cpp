@@ -0,0 +1,176 @@
+#include "UploadContext.h"
+#include <stdexcept>
+#include "VulkanHelperFunctions.h"
+
+void UploadContext::Create(VkDevice &device, uint32_t queueFamilyIndex, VkQueue queue, uint32_t graphicsQueueFamilyIndex,
+                           bool useTimelineSemaphore) {
+    m_queue = queue;
+    m_queueFamilyIndex = queueFamilyIndex;
+    m_graphicsQueueFamilyIndex = graphicsQueueFamilyIndex;
+    m_ownershipTransfer = queueFamilyIndex != graphicsQueueFamilyIndex;
+    if (m_ownershipTransfer && !useTimelineSemaphore) {
+        throw std::runtime_error("Failed to create upload context, a transfer queue requires the timeline semaphore!");
+    }
+    m_concurrentQueueFamilies.clear();
+    if (m_ownershipTransfer) {
+        m_concurrentQueueFamilies = {graphicsQueueFamilyIndex, queueFamilyIndex};
+    }
+    // command buffers are reset one by one when their batch has completed
+    VkCommandPoolCreateInfo poolInfo = {};
+    poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    poolInfo.queueFamilyIndex = queueFamilyIndex;
+    poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT | VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+    if (vkCreateCommandPool(device, &poolInfo, HostAllocator::GetCallbacks(), &m_commandPool) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create upload command pool!");
+    }
+    m_timeline.Create(device, useTimelineSemaphore);
+}
+
+void UploadContext::Destroy(VkDevice &device) {
+    m_timeline.WaitIdle(device);
+    m_timeline.Destroy(device);
+    // the command buffers are freed with the pool
+    vkDestroyCommandPool(device, m_commandPool, HostAllocator::GetCallbacks());
+    m_commandBuffer = VK_NULL_HANDLE;
+    m_pendingCommandBuffers.clear();
+    m_freeCommandBuffers.clear();
+    m_imageBarriers.clear();
+    m_unacquiredImageBarriers.clear();
+    m_unacquiredValue = 0;
+}
+
+void UploadContext::CopyBuffer(VkDevice &device, const StagingAllocation &staging, VkBuffer dstBuffer, VkDeviceSize size, VkDeviceSize dstOffset) {
+    // the buffer is concurrent over both queue families, the semaphore wait of the graphics queue makes the writes visible
+    VulkanHelperFunctions::CopyBuffer(GetCommandBuffer(device), staging.buffer, dstBuffer, size, staging.offset, dstOffset);
+}
+
+void UploadContext::CopyBufferContents(VkDevice &device, VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size) {
+    VkCommandBuffer commandBuffer = GetCommandBuffer(device);
+    // transfer writes of this and the earlier batches on the queue against the copy, and the copy against the later writes
+    VkMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+    VulkanHelperFunctions::CopyBuffer(commandBuffer, srcBuffer, dstBuffer, size);
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+}
+
+void UploadContext::CopyBufferToImage(VkDevice &device, const StagingAllocation &staging, VkImage image, VkFormat format,
+                                      uint32_t width, uint32_t height) {
+    VkCommandBuffer commandBuffer = GetCommandBuffer(device);
+    VulkanHelperFunctions::TransitionImageLayout(commandBuffer, image, format, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+    VulkanHelperFunctions::CopyBufferToImage(commandBuffer, staging.buffer, image, width, height, staging.offset);
+    if (!m_ownershipTransfer) {
+        VulkanHelperFunctions::TransitionImageLayout(commandBuffer, image, format, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+        return;
+    }
+    // the transfer queue can't use the fragment shader stage, the layout transition is part of the ownership transfer
+    VkImageMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    barrier.srcQueueFamilyIndex = m_queueFamilyIndex;
+    barrier.dstQueueFamilyIndex = m_graphicsQueueFamilyIndex;
+    barrier.image = image;
+    barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    barrier.subresourceRange.baseMipLevel = 0;
+    barrier.subresourceRange.levelCount = 1;
+    barrier.subresourceRange.baseArrayLayer = 0;
+    barrier.subresourceRange.layerCount = 1;
+    m_imageBarriers.push_back(barrier);
+}
+
+VkCommandBuffer UploadContext::GetCommandBuffer(VkDevice &device) {
+    if (m_commandBuffer != VK_NULL_HANDLE) {return m_commandBuffer;}
+
+    RecycleCommandBuffers(device);
+    if (m_freeCommandBuffers.empty()) {
+        VkCommandBufferAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        allocInfo.commandPool = m_commandPool;
+        allocInfo.commandBufferCount = 1;
+        VkCommandBuffer commandBuffer;
+        if (vkAllocateCommandBuffers(device, &allocInfo, &commandBuffer) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to allocate upload command buffer!");
+        }
+        m_freeCommandBuffers.push_back(commandBuffer);
+    }
+    m_commandBuffer = m_freeCommandBuffers.back();
+    m_freeCommandBuffers.pop_back();
+
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    if (vkBeginCommandBuffer(m_commandBuffer, &beginInfo) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to begin recording upload command buffer!");
+    }
+    return m_commandBuffer;
+}
+
+uint64_t UploadContext::Submit(VkDevice &device) {
+    if (m_commandBuffer == VK_NULL_HANDLE) {return m_timeline.GetLastSubmittedValue();}
+
+    if (m_ownershipTransfer) {
+        // release: the access masks of the destination are ignored here, the graphics queue acquires with the same barriers
+        if (!m_imageBarriers.empty()) {
+            vkCmdPipelineBarrier(m_commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr, 0, nullptr,
+                                 static_cast<uint32_t>(m_imageBarriers.size()), m_imageBarriers.data());
+        }
+    } else {
+        // the uploaded vertex/index buffers and images are read by the commands submitted after this batch
+        VkMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT | VK_ACCESS_SHADER_READ_BIT;
+        vkCmdPipelineBarrier(m_commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, UPLOAD_CONSUMER_STAGES, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+    }
+    if (vkEndCommandBuffer(m_commandBuffer) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to record upload command buffer!");
+    }
+
+    VkSubmitInfo submitInfo{};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &m_commandBuffer;
+    uint64_t value = m_timeline.Submit(device, m_queue, submitInfo);
+
+    m_pendingCommandBuffers.emplace_back(value, m_commandBuffer);
+    m_commandBuffer = VK_NULL_HANDLE;
+    if (m_ownershipTransfer) {
+        m_unacquiredImageBarriers.insert(m_unacquiredImageBarriers.end(), m_imageBarriers.begin(), m_imageBarriers.end());
+        m_unacquiredValue = value;
+        m_imageBarriers.clear();
+    }
+    return value;
+}
+
+uint64_t UploadContext::CmdAcquireUploads(VkCommandBuffer commandBuffer) {
+    if (!m_unacquiredImageBarriers.empty()) {
+        // acquire: chained to the semaphore wait of the submission, which waits at the consumer stages
+        vkCmdPipelineBarrier(commandBuffer, UPLOAD_CONSUMER_STAGES, UPLOAD_CONSUMER_STAGES, 0, 0, nullptr, 0, nullptr,
+                             static_cast<uint32_t>(m_unacquiredImageBarriers.size()), m_unacquiredImageBarriers.data());
+        m_unacquiredImageBarriers.clear();
+    }
+    // buffer uploads have no barrier to acquire, but still have to be waited for
+    uint64_t value = m_unacquiredValue;
+    m_unacquiredValue = 0;
+    return value;
+}
+
+void UploadContext::Flush(VkDevice &device) {
+    m_timeline.Wait(device, Submit(device));
+    RecycleCommandBuffers(device);
+}
+
+void UploadContext::RecycleCommandBuffers(VkDevice &device) {
+    while (!m_pendingCommandBuffers.empty() && m_timeline.IsCompleted(device, m_pendingCommandBuffers.front().first)) {
+        VkCommandBuffer commandBuffer = m_pendingCommandBuffers.front().second;
+        vkResetCommandBuffer(commandBuffer, 0);
+        m_freeCommandBuffers.push_back(commandBuffer);
+        m_pendingCommandBuffers.pop_front();
+    }
+}
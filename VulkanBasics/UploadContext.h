@@ -0,0 +1,91 @@
+#ifndef VULKANBASICS_UPLOADCONTEXT_H
+#define VULKANBASICS_UPLOADCONTEXT_H
+#include <vulkan/vulkan.h>
+#include <cstdint>
+#include <deque>
+#include <utility>
+#include <vector>
+#include "GpuTimeline.h"
+#include "StagingArena.h"
+
+// stages of the graphics queue reading the uploaded resources
+#define UPLOAD_CONSUMER_STAGES (VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT)
+
+// Records the copies and layout transitions of resource uploads into one command buffer per batch,
+// which is submitted once instead of submitting and waiting for the queue after every command.
+// Each submitted batch gets a value of the context's timeline that callers can wait for or poll.
+//
+// On the graphics queue, the batch ends with a barrier making the transfer writes visible to the vertex input
+// and the shaders, so later submissions to the same queue can use the uploaded resources.
+// On a dedicated transfer queue, the graphics queue waits for the batch's value of the timeline semaphore
+// (CmdAcquireUploads returns it), so uploads overlap rendering and only the frames using them wait.
+// Images are released to the graphics queue family by the batch and acquired by the graphics queue.
+// Buffers receiving uploads are written in ranges while the graphics queue draws from the rest of them, so they are
+// created concurrent over both families (GetConcurrentQueueFamilies) and need no ownership transfer.
+class UploadContext {
+public:
+    // a transfer queue of another family than graphicsQueueFamilyIndex needs the timeline semaphore for the handoff
+    void Create(VkDevice& device, uint32_t queueFamilyIndex, VkQueue queue, uint32_t graphicsQueueFamilyIndex, bool useTimelineSemaphore);
+    void Destroy(VkDevice& device);
+
+    // record copying staged data to a range of a vertex/index buffer, created with GetConcurrentQueueFamilies()
+    void CopyBuffer(VkDevice& device, const StagingAllocation& staging, VkBuffer dstBuffer, VkDeviceSize size, VkDeviceSize dstOffset = 0);
+    // record copying the first size bytes of a buffer into another one (both created with GetConcurrentQueueFamilies()),
+    // after the copies into the source recorded so far and before the copies into the destination recorded later
+    void CopyBufferContents(VkDevice& device, VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size);
+    // record copying staged pixels to a sampled image, which ends up in VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
+    void CopyBufferToImage(VkDevice& device, const StagingAllocation& staging, VkImage image, VkFormat format, uint32_t width, uint32_t height);
+    inline bool HasRecordedCommands() const {return m_commandBuffer != VK_NULL_HANDLE;}
+
+    // end and submit the current batch, returns the value signaled when it has completed
+    // (the value of the last batch if nothing has been recorded)
+    uint64_t Submit(VkDevice& device);
+
+    // record the image ownership acquires of the submitted batches into a graphics command buffer (outside of a render pass),
+    // returns the value of GetSemaphore() its submission must wait for, 0 if there is nothing to wait for
+    uint64_t CmdAcquireUploads(VkCommandBuffer commandBuffer);
+    inline VkSemaphore GetSemaphore() const {return m_timeline.GetSemaphore();}
+    inline bool UsesOwnershipTransfer() const {return m_ownershipTransfer;}
+    // queue families the destination buffers of CopyBuffer must be shared by, empty if uploads run on the graphics queue
+    inline const std::vector<uint32_t>& GetConcurrentQueueFamilies() const {return m_concurrentQueueFamilies;}
+
+    inline bool IsCompleted(VkDevice& device, uint64_t value) {return m_timeline.IsCompleted(device, value);}
+    inline uint64_t GetCompletedValue(VkDevice& device) {return m_timeline.GetCompletedValue(device);}
+    inline void Wait(VkDevice& device, uint64_t value) {m_timeline.Wait(device, value);}
+    // submit the current batch and wait for all of them
+    void Flush(VkDevice& device);
+
+    // batches submitted since Create()
+    inline uint64_t GetSubmitCount() const {return m_timeline.GetLastSubmittedValue();}
+
+private:
+    // command buffer of the current batch, begun when first needed
+    VkCommandBuffer GetCommandBuffer(VkDevice& device);
+    // command buffers of completed batches can be recorded again
+    void RecycleCommandBuffers(VkDevice& device);
+
+private:
+    VkQueue m_queue = VK_NULL_HANDLE;
+    VkCommandPool m_commandPool = VK_NULL_HANDLE;
+    GpuTimeline m_timeline;
+
+    VkCommandBuffer m_commandBuffer = VK_NULL_HANDLE;
+    // (value, command buffer) of the submitted batches in submission order, and the reset command buffers
+    std::deque<std::pair<uint64_t, VkCommandBuffer>> m_pendingCommandBuffers;
+    std::vector<VkCommandBuffer> m_freeCommandBuffers;
+
+    // queue family ownership transfer to the graphics queue family
+    bool m_ownershipTransfer = false;
+    uint32_t m_queueFamilyIndex = 0;
+    uint32_t m_graphicsQueueFamilyIndex = 0;
+    std::vector<uint32_t> m_concurrentQueueFamilies;
+    // image ownership transfer barriers of the current batch, recorded on both queues
+    std::vector<VkImageMemoryBarrier> m_imageBarriers;
+    // barriers of the submitted batches not acquired by the graphics queue yet,
+    // and the value the graphics queue hasn't waited for yet (0 if none)
+    std::vector<VkImageMemoryBarrier> m_unacquiredImageBarriers;
+    uint64_t m_unacquiredValue = 0;
+};
+
+
+#endif //VULKANBASICS_UPLOADCONTEXT_H
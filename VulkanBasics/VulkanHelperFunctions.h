@@ -7,6 +7,8 @@
 #include <fstream>
 #include <vector>
 #include <iostream>
+#include "DeviceMemoryAllocator.h"
+#include "HostAllocator.h"
 
 class  VulkanHelperFunctions{
 public:
@@ -31,19 +33,6 @@ public:
         return buffer;
     }
 
-    // find the memory type for buffer
-    static uint32_t FindMemoryType(VkPhysicalDevice& physicalDevice, uint32_t typeFilter, VkMemoryPropertyFlags properties){
-        VkPhysicalDeviceMemoryProperties memProperties;
-        vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memProperties);
-        for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++) {
-            // 1 << i  (means pow(2, i))
-            if ((typeFilter & (1 << i)) && (memProperties.memoryTypes[i].propertyFlags & properties) == properties) {
-                return i;
-            }
-        }
-        throw std::runtime_error("Failed to find suitable memory type!");
-    }
-
     // create a single image view
     static void CreateImageView(VkDevice& device, const VkImage& image, const VkFormat& format, VkImageView& imageView)
     {
@@ -58,13 +47,13 @@ public:
         viewInfo.subresourceRange.baseArrayLayer = 0;
         viewInfo.subresourceRange.layerCount = 1;
 
-        if (vkCreateImageView(device, &viewInfo, nullptr, &imageView) != VK_SUCCESS) {
+        if (vkCreateImageView(device, &viewInfo, HostAllocator::GetCallbacks(), &imageView) != VK_SUCCESS) {
             throw std::runtime_error("Failed to create texture image view!");
         }
     }
 
     // create image object
-    static void CreateImage(VkDevice& device, VkPhysicalDevice& physicalDevice, uint32_t width, uint32_t height, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties, VkImage& image, VkDeviceMemory& imageMemory)
+    static void CreateImage(VkDevice& device, DeviceMemoryAllocator& allocator, uint32_t width, uint32_t height, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties, MemoryCategory category, VkImage& image, MemoryAllocation& imageMemory)
     {
         VkImageCreateInfo imageInfo{};
         imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
@@ -81,31 +70,31 @@ public:
         imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
         imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
 
-        if (vkCreateImage(device, &imageInfo, nullptr, &image) != VK_SUCCESS) {
+        if (vkCreateImage(device, &imageInfo, HostAllocator::GetCallbacks(), &image) != VK_SUCCESS) {
             throw std::runtime_error("Failed to create image!");
         }
 
         VkMemoryRequirements memRequirements;
         vkGetImageMemoryRequirements(device, image, &memRequirements);
 
-        VkMemoryAllocateInfo allocInfo{};
-        allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-        allocInfo.allocationSize = memRequirements.size;
-        allocInfo.memoryTypeIndex = FindMemoryType(physicalDevice, memRequirements.memoryTypeBits, properties);
-
-        if (vkAllocateMemory(device, &allocInfo, nullptr, &imageMemory) != VK_SUCCESS) {
-            throw std::runtime_error("Failed to allocate image memory!");
-        }
+        // sub-allocate the memory from a block of the allocator
+        imageMemory = allocator.Allocate(device, memRequirements, properties, tiling == VK_IMAGE_TILING_LINEAR, category);
+        vkBindImageMemory(device, image, imageMemory.memory, imageMemory.offset);
+    }
 
-        vkBindImageMemory(device, image, imageMemory, 0);
+    // destroy image object and give its memory back to the allocator
+    static void DestroyImage(VkDevice& device, DeviceMemoryAllocator& allocator, VkImage& image, MemoryAllocation& imageMemory)
+    {
+        vkDestroyImage(device, image, HostAllocator::GetCallbacks());
+        allocator.Free(device, imageMemory);
+        image = VK_NULL_HANDLE;
     }
 
-    // copy buffer to image
-    static void CopyBufferToImage(VkDevice& device, VkBuffer buffer, VkCommandPool& commandPool, VkQueue& queue, VkImage image, uint32_t width, uint32_t height)
+    // record copying buffer to image
+    static void CopyBufferToImage(VkCommandBuffer commandBuffer, VkBuffer buffer, VkImage image, uint32_t width, uint32_t height, VkDeviceSize bufferOffset = 0)
     {
-        VkCommandBuffer commandBuffer = BeginSingleTimeCommands(device, commandPool);
         VkBufferImageCopy region{};
-        region.bufferOffset = 0;
+        region.bufferOffset = bufferOffset;
         region.bufferRowLength = 0;
         region.bufferImageHeight = 0;
 
@@ -117,14 +106,11 @@ public:
         region.imageOffset = {0, 0, 0};
         region.imageExtent = {width, height,1};
         vkCmdCopyBufferToImage(commandBuffer, buffer,image,VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,1,&region);
-
-        EndSingleTimeCommands(device, commandBuffer, commandPool, queue);
     }
 
-    // transit image layout
-    static void TransitionImageLayout(VkDevice& device, VkCommandPool& commandPool, VkQueue& queue, VkImage image, VkFormat format, VkImageLayout oldLayout, VkImageLayout newLayout)
+    // record transiting image layout
+    static void TransitionImageLayout(VkCommandBuffer commandBuffer, VkImage image, VkFormat format, VkImageLayout oldLayout, VkImageLayout newLayout)
     {
-        VkCommandBuffer commandBuffer = BeginSingleTimeCommands(device, commandPool);
         VkImageMemoryBarrier barrier{};
         barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
         barrier.oldLayout = oldLayout;
@@ -158,20 +144,25 @@ public:
         }
 
         vkCmdPipelineBarrier(commandBuffer, sourceStage, destinationStage,0,0, nullptr,0, nullptr,1, &barrier);
-        EndSingleTimeCommands(device, commandBuffer, commandPool, queue);
     }
 
 
-    // create buffer
-    static void CreateBuffer(VkDevice& device, VkPhysicalDevice& physicalDevice, VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties,
-                                         VkBuffer &buffer, VkDeviceMemory &bufferMemory) {
+    // create buffer, shared by the queue families of concurrentQueueFamilies if it has more than one (no ownership transfers)
+    static void CreateBuffer(VkDevice& device, DeviceMemoryAllocator& allocator, VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, MemoryCategory category,
+                                         VkBuffer &buffer, MemoryAllocation &bufferMemory, const std::vector<uint32_t>& concurrentQueueFamilies = {}) {
         // create the buffer
         VkBufferCreateInfo bufferInfo{};
         bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
         bufferInfo.size = size;
         bufferInfo.usage = usage;
-        bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-        if (vkCreateBuffer(device, &bufferInfo, nullptr, &buffer) != VK_SUCCESS) {
+        if (concurrentQueueFamilies.size() > 1) {
+            bufferInfo.sharingMode = VK_SHARING_MODE_CONCURRENT;
+            bufferInfo.queueFamilyIndexCount = static_cast<uint32_t>(concurrentQueueFamilies.size());
+            bufferInfo.pQueueFamilyIndices = concurrentQueueFamilies.data();
+        } else {
+            bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        }
+        if (vkCreateBuffer(device, &bufferInfo, HostAllocator::GetCallbacks(), &buffer) != VK_SUCCESS) {
             throw std::runtime_error("Failed to create buffer!");
         }
 
@@ -180,69 +171,34 @@ public:
         VkMemoryRequirements memRequirements;
         vkGetBufferMemoryRequirements(device, buffer, &memRequirements);
 
-        // allocate the memory to the buffer
-        VkMemoryAllocateInfo allocInfo{};
-        allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-        allocInfo.allocationSize = memRequirements.size;
-        allocInfo.memoryTypeIndex = FindMemoryType(physicalDevice, memRequirements.memoryTypeBits, properties);
-
-        if (vkAllocateMemory(device, &allocInfo, nullptr, &bufferMemory) != VK_SUCCESS) {
-            throw std::runtime_error("failed to allocate buffer memory!");
+        // sub-allocate the memory from a block of the allocator, host visible memory comes mapped
+        try {
+            bufferMemory = allocator.Allocate(device, memRequirements, properties, true, category);
+        } catch (const std::runtime_error&) {
+            // the caller may retry with other properties
+            vkDestroyBuffer(device, buffer, HostAllocator::GetCallbacks());
+            buffer = VK_NULL_HANDLE;
+            throw;
         }
 
         // associate the memory with the buffer
-        vkBindBufferMemory(device, buffer, bufferMemory, 0);
+        vkBindBufferMemory(device, buffer, bufferMemory.memory, bufferMemory.offset);
     }
 
-    // copy buffer
-    static void CopyBuffer(VkDevice& device, VkCommandPool& commandPool, VkQueue& queue, VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize bufferSize) {
-        VkCommandBuffer commandBuffer = BeginSingleTimeCommands(device, commandPool);
+    // destroy buffer and give its memory back to the allocator
+    static void DestroyBuffer(VkDevice& device, DeviceMemoryAllocator& allocator, VkBuffer& buffer, MemoryAllocation& bufferMemory) {
+        vkDestroyBuffer(device, buffer, HostAllocator::GetCallbacks());
+        allocator.Free(device, bufferMemory);
+        buffer = VK_NULL_HANDLE;
+    }
 
-        // bind transferring operation with the temp command buffer
+    // record copying buffer
+    static void CopyBuffer(VkCommandBuffer commandBuffer, VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize bufferSize, VkDeviceSize srcOffset = 0, VkDeviceSize dstOffset = 0) {
         VkBufferCopy copyRegion{};
-        copyRegion.srcOffset = 0; // Optional
-        copyRegion.dstOffset = 0; // Optional
+        copyRegion.srcOffset = srcOffset;
+        copyRegion.dstOffset = dstOffset;
         copyRegion.size = bufferSize;
         vkCmdCopyBuffer(commandBuffer, srcBuffer, dstBuffer, 1, &copyRegion);
-
-        // end the recording temp command buffer
-        EndSingleTimeCommands(device, commandBuffer, commandPool, queue);
-    }
-
-private:
-    static VkCommandBuffer BeginSingleTimeCommands(VkDevice& device, VkCommandPool& commandPool) {
-        VkCommandBufferAllocateInfo allocInfo{};
-        allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-        allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-        allocInfo.commandPool = commandPool;
-        allocInfo.commandBufferCount = 1;
-
-        VkCommandBuffer commandBuffer;
-        vkAllocateCommandBuffers(device, &allocInfo, &commandBuffer);
-
-        VkCommandBufferBeginInfo beginInfo{};
-        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-        beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
-
-        vkBeginCommandBuffer(commandBuffer, &beginInfo);
-
-        return commandBuffer;
-    }
-
-    static void EndSingleTimeCommands(VkDevice& device, VkCommandBuffer commandBuffer, VkCommandPool& commandPool, VkQueue& queue) {
-        vkEndCommandBuffer(commandBuffer);
-
-        // submit the command to the m_graphicsQueue (graphic queue family implicitly supports transfer operations)
-        // TODO create a transferQueue to specifically operate transferring operations
-        VkSubmitInfo submitInfo{};
-        submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-        submitInfo.commandBufferCount = 1;
-        submitInfo.pCommandBuffers = &commandBuffer;
-
-        vkQueueSubmit(queue, 1, &submitInfo, VK_NULL_HANDLE);
-        vkQueueWaitIdle(queue);
-
-        vkFreeCommandBuffers(device, commandPool, 1, &commandBuffer);
     }
 };
 
@@ -1,5 +1,8 @@
 #include <iostream>
+#include <cstdio>
 #include <cstdlib>
+#include <deque>
+#include <vector>
 #define NO_VALIDATION_DEBUG
 #include "BasicApplication.h"
 
@@ -29,10 +32,194 @@
 
 // here to define the task
 #define Task123
+// measure frame throughput with 1, 2 and 3 frames in flight (for a software driver, e.g. lavapipe,
+// point VK_ICD_FILENAMES to its ICD json before running, remove NO_VALIDATION_DEBUG to run under the validation layers)
+//#define BenchmarkFramesInFlight
+#define BENCHMARK_FRAME_COUNT 2000
+// render offscreen without a window (e.g. on lavapipe/SwiftShader machines without a GPU)
+//#define RunHeadless
+#define HEADLESS_FRAME_COUNT 1000
+// measure the frame pacing (interval and jitter) of each present policy
+//#define BenchmarkPresentPolicies
+#define PRESENT_POLICY_FRAME_COUNT 600
+#define PRESENT_POLICY_TARGET_FPS 60.0
+// measure the CPU cost of recording the command buffer every frame with 10, 1k and 10k objects,
+// on the render thread only and with 1, 3 and 7 worker threads
+//#define BenchmarkCommandRecording
+#define RECORDING_FRAME_COUNT 500
+// add and remove objects every frame while running, the memory statistics at clean up should match a static scene
+//#define BenchmarkObjectChurn
+#define CHURN_FRAME_COUNT 2000
+#define CHURN_OBJECT_COUNT 100
+// measure the startup time without the pipeline cache file (cold) and with the file the first run wrote (warm)
+//#define BenchmarkPipelineCache
+#define PIPELINE_CACHE_FRAME_COUNT 10
+// count the host allocations of the driver by scope and per frame (reported at clean up)
+//#define TrackHostAllocations
+// print the memory, upload, pipeline and object statistics at start up and clean up
+//#define PrintStatistics
+// draw the scene into side by side views with the same pipelines (split screen)
+//#define SplitScreen
+#define SPLIT_SCREEN_VIEW_COUNT 2
 
 int main() {
+#ifdef BenchmarkFramesInFlight
+    // throughput of each frames in flight count, summarized at the end
+    std::vector<double> framesPerSecond;
+    for (uint32_t framesInFlight = 1; framesInFlight <= 3; framesInFlight++) {
+        ApplicationSettings settings;
+        settings.framesInFlight = framesInFlight;
+#ifdef RunHeadless
+        settings.headless = true;
+#endif
+        BasicApplication benchmarkApp;
+        benchmarkApp.InitialApplication(800, 600, "Frames In Flight Benchmark", settings);
+        benchmarkApp.AddObjectToApplication("Rectangle", ObjectType::FixedRectangle, nullptr, "textures/texture.jpg");
+        benchmarkApp.AddObjectToApplication("Triangle", ObjectType::FixedTriangle, nullptr, "textures/texture.jpg");
+        try{
+            // MainLoop prints the frame throughput when it returns
+            benchmarkApp.RunApplication(BENCHMARK_FRAME_COUNT);
+        } catch(const std::exception& e) {
+            std::cerr << e.what() << std::endl;
+            return EXIT_FAILURE;
+        }
+        framesPerSecond.push_back(benchmarkApp.GetFramesPerSecond());
+    }
+    for (size_t i = 0; i < framesPerSecond.size(); i++) {
+        std::cout << "N=" << i + 1 << ": " << framesPerSecond[i] << " fps";
+        if (framesPerSecond[0] > 0.0) {
+            std::cout << " (" << framesPerSecond[i] / framesPerSecond[0] << "x of N=1)";
+        }
+        std::cout << std::endl;
+    }
+    return EXIT_SUCCESS;
+#endif
+#ifdef BenchmarkPresentPolicies
+    for (int policyIndex = 0; policyIndex < static_cast<int>(PresentPolicy::Count); policyIndex++) {
+        ApplicationSettings settings;
+        settings.presentPolicy = static_cast<PresentPolicy>(policyIndex);
+        settings.targetFps = PRESENT_POLICY_TARGET_FPS;
+        // the frame pacing report at clean up is the result of the benchmark
+        settings.printStatistics = true;
+        BasicApplication benchmarkApp;
+        benchmarkApp.InitialApplication(800, 600, "Present Policy Benchmark", settings);
+        benchmarkApp.AddObjectToApplication("Rectangle", ObjectType::FixedRectangle, nullptr, "textures/texture.jpg");
+        benchmarkApp.AddObjectToApplication("Triangle", ObjectType::FixedTriangle, nullptr, "textures/texture.jpg");
+        try{
+            // the frame pacing report is printed at clean up
+            benchmarkApp.RunApplication(PRESENT_POLICY_FRAME_COUNT);
+        } catch(const std::exception& e) {
+            std::cerr << e.what() << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+    return EXIT_SUCCESS;
+#endif
+#ifdef BenchmarkCommandRecording
+    for (uint32_t objectCount : {10u, 1000u, 10000u})
+    for (int recordingThreadCount : {0, 1, 3, 7}) {
+        ApplicationSettings settings;
+#ifdef RunHeadless
+        settings.headless = true;
+#endif
+        // the query pool would need a timestamp pair for each object
+        settings.enableGpuProfiler = false;
+        settings.recordingThreadCount = recordingThreadCount;
+        // split even the small scenes, to see the overhead of the threads
+        settings.minObjectsPerRecordingThread = 1;
+        BasicApplication benchmarkApp;
+        benchmarkApp.InitialApplication(800, 600, "Command Recording Benchmark", settings);
+        for (uint32_t i = 0; i < objectCount; i++) {
+            benchmarkApp.AddObjectToApplication("Triangle", ObjectType::FixedTriangle, nullptr, "textures/texture.jpg");
+        }
+        try{
+            benchmarkApp.RunApplication(RECORDING_FRAME_COUNT);
+        } catch(const std::exception& e) {
+            std::cerr << e.what() << std::endl;
+            return EXIT_FAILURE;
+        }
+        const FramePhaseStatistics& record = benchmarkApp.GetFrameTimingReport().phases[static_cast<size_t>(FramePhase::Record)];
+        std::cout << objectCount << " objects, " << recordingThreadCount << " worker threads: recording mean " << record.mean << " ms, p50 " << record.p50
+                  << " ms, p99 " << record.p99 << " ms" << std::endl;
+    }
+    return EXIT_SUCCESS;
+#endif
+
+#ifdef BenchmarkPipelineCache
+    {
+        // startup time of the cold run, then of the warm run
+        std::vector<double> startupTimes;
+        for (bool warm : {false, true}) {
+            ApplicationSettings settings;
+#ifdef RunHeadless
+            settings.headless = true;
+#endif
+            if (!warm && settings.pipelineCacheFile) {
+                std::remove(settings.pipelineCacheFile);
+            }
+            BasicApplication benchmarkApp;
+            benchmarkApp.InitialApplication(800, 600, "Pipeline Cache Benchmark", settings);
+            benchmarkApp.AddObjectToApplication("Rectangle", ObjectType::FixedRectangle, nullptr, "textures/texture.jpg");
+            benchmarkApp.AddObjectToApplication("Triangle", ObjectType::FixedTriangle, nullptr, "textures/texture.jpg");
+            try{
+                benchmarkApp.RunApplication(PIPELINE_CACHE_FRAME_COUNT);
+            } catch(const std::exception& e) {
+                std::cerr << e.what() << std::endl;
+                return EXIT_FAILURE;
+            }
+            startupTimes.push_back(benchmarkApp.GetStartupTime());
+        }
+        std::cout << "Startup: cold " << startupTimes[0] << " ms, warm " << startupTimes[1] << " ms" << std::endl;
+    }
+    return EXIT_SUCCESS;
+#endif
+
+#ifdef BenchmarkObjectChurn
+    {
+        ApplicationSettings settings;
+#ifdef RunHeadless
+        settings.headless = true;
+#endif
+        settings.enableGpuProfiler = false;
+        // the memory statistics at clean up are the result of the benchmark
+        settings.printStatistics = true;
+        BasicApplication benchmarkApp;
+        benchmarkApp.InitialApplication(800, 600, "Object Churn Benchmark", settings);
+        std::deque<BaseObject*> churnObjects;
+        for (uint32_t i = 0; i < CHURN_OBJECT_COUNT; i++) {
+            churnObjects.push_back(benchmarkApp.AddObjectToApplication("Triangle", ObjectType::FixedTriangle, nullptr, "textures/texture.jpg"));
+        }
+        // replace the oldest object every frame
+        benchmarkApp.SetFrameCallback([&](uint64_t) {
+            benchmarkApp.RemoveObjectFromApplication(churnObjects.front());
+            churnObjects.pop_front();
+            churnObjects.push_back(benchmarkApp.AddObjectToApplication("Triangle", ObjectType::FixedTriangle, nullptr, "textures/texture.jpg"));
+        });
+        try{
+            benchmarkApp.RunApplication(CHURN_FRAME_COUNT);
+        } catch(const std::exception& e) {
+            std::cerr << e.what() << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+    return EXIT_SUCCESS;
+#endif
+
+    ApplicationSettings settings;
+#ifdef RunHeadless
+    settings.headless = true;
+#endif
+#ifdef TrackHostAllocations
+    settings.trackHostAllocations = true;
+#endif
+#ifdef PrintStatistics
+    settings.printStatistics = true;
+#endif
+#ifdef SplitScreen
+    settings.viewCount = SPLIT_SCREEN_VIEW_COUNT;
+#endif
     BasicApplication basicApp;
-    basicApp.InitialApplication(800, 600, "Basic App");
+    basicApp.InitialApplication(800, 600, "Basic App", settings);
     // add object to application
 #ifdef Task123
     basicApp.AddObjectToApplication("Rectangle", ObjectType::FixedRectangle, nullptr, "textures/texture.jpg");
@@ -42,7 +229,8 @@ int main() {
     basicApp.AddObjectToApplication("room", ObjectType::OBJ_Model, "Mesh/viking_room.obj", "textures/viking_room.png");
 #endif
     try{
-        basicApp.RunApplication();
+        // headless application has no window to close, so it draws a fixed number of frames
+        basicApp.RunApplication(settings.headless ? HEADLESS_FRAME_COUNT : 0);
     } catch(const std::exception& e) {
         std::cerr << e.what() << std::endl;
         return EXIT_FAILURE;